@@ -0,0 +1,232 @@
+// export-generator.cpp : Synthetic Planning Center attendance exports
+//
+
+#include "export-generator.h"
+#include "dates.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // splitmix64, small and identical on every platform
+    class Random
+    {
+    public:
+        explicit Random(uint64_t seed) : state(seed) {}
+
+        uint64_t Next()
+        {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        // Uniform in [0, 1)
+        double Unit() { return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+
+        // Uniform in [0, n)
+        uint32_t Below(uint32_t n) { return n ? static_cast<uint32_t>(Next() % n) : 0; }
+
+    private:
+        uint64_t state;
+    };
+
+    int64_t FirstSundayDay(const ExportGeneratorOptions& options)
+    {
+        int y{ 2023 };
+        unsigned m{ 1 }, d{ 1 };
+        std::sscanf(options.first_sunday.c_str(), "%d-%u-%u", &y, &m, &d);
+        int64_t day = DaysFromCivil(y, m, d);
+
+        while (WeekdayFromDays(day) != 0)
+            ++day;
+        return day;
+    }
+
+    // The header format the export uses, e.g. 1/7/2024
+    std::string HeaderDate(int64_t day)
+    {
+        int y;
+        unsigned m, d;
+        CivilFromDays(day, y, m, d);
+        return std::to_string(m) + "/" + std::to_string(d) + "/" + std::to_string(y);
+    }
+
+    std::string FileDate(int64_t day)
+    {
+        int y;
+        unsigned m, d;
+        CivilFromDays(day, y, m, d);
+        // Wide enough for any int and two unsigneds, so the compiler can see nothing is cut off
+        char buffer[36];
+        std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", y, m, d);
+        return buffer;
+    }
+
+    const char* const firstNames[] = {
+        "Emma", "Liam", "Olivia", "Noah", "Ava", "Elijah", "Sophia", "James", "Isabella", "Benjamin",
+        "Mia", "Lucas", "Charlotte", "Mason", "Amelia", "Ethan", "Harper", "Logan", "Evelyn", "Jacob",
+        "Abigail", "Michael", "Emily", "Daniel", "Ella", "Henry", "Madison", "Jackson", "Scarlett", "Sebastian",
+        "Grace", "Aiden", "Chloe", "Matthew", "Victoria", "Samuel", "Riley", "David", "Aria", "Joseph",
+    };
+
+    const char* const lastNames[] = {
+        "Smith", "Johnson", "Williams", "Brown", "Jones", "Garcia", "Miller", "Davis", "Rodriguez", "Martinez",
+        "Hernandez", "Lopez", "Gonzalez", "Wilson", "Anderson", "Thomas", "Taylor", "Moore", "Jackson", "Martin",
+        "Lee", "Perez", "Thompson", "White", "Harris", "Sanchez", "Clark", "Ramirez", "Lewis", "Robinson",
+        "Walker", "Young", "Allen", "King", "Wright", "Scott", "Torres", "Nguyen", "Hill", "Flores",
+    };
+
+    enum class Role
+    {
+        MEMBER,
+        LEADER,
+        VISITOR,
+    };
+
+    // One column of the export, which Sunday it belongs to and what kind of event it is
+    struct Column
+    {
+        uint32_t sunday{ 0 };
+        bool sunday_school{ true };
+        bool weekday{ false };
+    };
+}
+
+uint64_t GenerateExport(const ExportGeneratorOptions& options, std::ostream& out)
+{
+    Random random{ options.seed };
+    const char* newline = options.crlf ? "\r\n" : "\n";
+    const int64_t firstDay = FirstSundayDay(options);
+
+    // Lay out the event columns in the order Planning Center lists them
+    std::vector<Column> columns;
+    std::string header{ "first name,last name,percent" };
+    for (uint32_t s = 0; s < options.sundays; ++s)
+    {
+        const int64_t day = firstDay + 7 * static_cast<int64_t>(s);
+        columns.push_back({ s, true, false });
+        header += "," + HeaderDate(day);
+
+        if (options.duplicate_every && s % options.duplicate_every == options.duplicate_every - 1)
+        {
+            columns.push_back({ s, false, false });
+            header += "," + HeaderDate(day);
+        }
+        if (options.weekday_every && s % options.weekday_every == options.weekday_every - 1)
+        {
+            columns.push_back({ s, false, true });
+            header += "," + HeaderDate(day + 3);
+        }
+    }
+
+    // Sundays where attendance wasn't taken for anyone
+    std::vector<bool> notTaken(options.sundays);
+    for (uint32_t s = 0; s < options.sundays; ++s)
+        notTaken[s] = random.Unit() < options.not_taken_rate;
+
+    uint64_t bytes{ 0 };
+    auto write = [&](const std::string& s)
+        {
+            out.write(s.data(), static_cast<std::streamsize>(s.size()));
+            bytes += s.size();
+        };
+
+    if (options.bom)
+        write("\xEF\xBB\xBF");
+    write(header + newline);
+
+    std::string row;
+    std::vector<const char*> cells(columns.size());
+    for (uint32_t m = 0; m < options.members; ++m)
+    {
+        // Who is this person, and when were they on the roll
+        const double r = random.Unit();
+        const Role role = r < options.leader_share ? Role::LEADER
+            : r < options.leader_share + options.visitor_share ? Role::VISITOR
+            : Role::MEMBER;
+
+        uint32_t joined{ 0 };
+        if (options.sundays > 1 && random.Unit() < options.late_join_share)
+            joined = 1 + random.Below(options.sundays - 1);
+
+        uint32_t left{ options.sundays };
+        if (options.sundays > joined + 1 && random.Unit() < 0.05)
+            left = joined + 1 + random.Below(options.sundays - joined - 1);
+
+        // Some people drift away partway through, those are the outreach list
+        uint32_t lapsed{ options.sundays };
+        if (options.sundays > joined + 1 && random.Unit() < 0.2)
+            lapsed = joined + 1 + random.Below(options.sundays - joined - 1);
+
+        double rate = options.attendance_rate * (0.5 + random.Unit());
+        if (role == Role::LEADER)
+            rate += 0.2;
+        else if (role == Role::VISITOR)
+            rate *= 0.3;
+        rate = rate < 0.02 ? 0.02 : rate > 0.98 ? 0.98 : rate;
+
+        uint32_t attended{ 0 }, possible{ 0 };
+        for (std::size_t c = 0; c < columns.size(); ++c)
+        {
+            const Column& column = columns[c];
+            const char*& cell = cells[c];
+
+            if (column.sunday < joined || column.sunday >= left)
+            {
+                cell = "membership removed";
+                continue;
+            }
+            if (notTaken[column.sunday] || (!column.sunday_school && random.Unit() < 0.3))
+            {
+                cell = "attendance not taken";
+                continue;
+            }
+
+            // Second events on a Sunday and weekday events are much smaller
+            const double chance = column.sunday_school ? (column.sunday >= lapsed ? rate * 0.05 : rate) : rate * 0.25;
+            const bool present = random.Unit() < chance;
+            if (present)
+            {
+                cell = role == Role::LEADER ? "attended as leader"
+                    : role == Role::VISITOR ? "attended as visitor"
+                    : "attended as member";
+            }
+            else
+            {
+                cell = "";
+            }
+
+            if (column.sunday_school)
+            {
+                ++possible;
+                attended += present ? 1 : 0;
+            }
+        }
+
+        row.clear();
+        row += firstNames[random.Below(sizeof(firstNames) / sizeof(firstNames[0]))];
+        row += ',';
+        row += lastNames[random.Below(sizeof(lastNames) / sizeof(lastNames[0]))];
+        row += ',';
+        row += std::to_string(possible ? (100 * attended + possible / 2) / possible : 0);
+        for (const char* cell : cells)
+        {
+            row += ',';
+            row += cell;
+        }
+        row += newline;
+        write(row);
+    }
+
+    return bytes;
+}
+
+std::string GeneratedExportFileName(const ExportGeneratorOptions& options)
+{
+    const int64_t firstDay = FirstSundayDay(options);
+    const int64_t lastDay = firstDay + 7 * static_cast<int64_t>(options.sundays ? options.sundays - 1 : 0);
+    return "attendance-report-young-adults-" + FileDate(firstDay) + "-" + FileDate(lastDay) + ".csv";
+}
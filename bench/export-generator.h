@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Writes synthetic Planning Center attendance-report exports for benchmarks and scale runs
+//  Output is fully determined by the options (own PRNG, no <random> distributions) so runs are comparable across compilers
+
+struct ExportGeneratorOptions
+{
+	uint32_t members{ 500 };
+	uint32_t sundays{ 52 };
+	std::string first_sunday{ "2023-01-01" }; // yyyy-mm-dd, moved forward to a Sunday if it isn't one
+
+	// Status mix
+	double leader_share{ 0.08 };     // fraction of people who attend as leaders
+	double visitor_share{ 0.15 };    // fraction who only ever visit
+	double attendance_rate{ 0.65 };  // chance someone on the roll attends on a given Sunday
+	double late_join_share{ 0.30 };  // fraction shown as "membership removed" until they join
+	double not_taken_rate{ 0.03 };   // chance nobody's attendance was taken on a Sunday
+
+	// Layout quirks seen in real exports
+	uint32_t duplicate_every{ 8 };   // every Nth Sunday has a second (non Sunday School) event on the same date, 0 disables
+	uint32_t weekday_every{ 0 };     // every Nth week has a Wednesday event that TokenizeHeaderRow should drop, 0 disables
+	bool crlf{ true };
+	bool bom{ false };
+
+	uint64_t seed{ 1 };
+};
+
+// Write the export, returns the number of bytes written
+uint64_t GenerateExport(const ExportGeneratorOptions& options, std::ostream& out);
+
+// The file name Planning Center would give this export, "attendance-report-young-adults-yyyy-mm-dd-yyyy-mm-dd.csv"
+std::string GeneratedExportFileName(const ExportGeneratorOptions& options);
@@ -0,0 +1,763 @@
+// eya-bench.cpp : Microbenchmarks for each pipeline stage, plus the synthetic export generator
+//
+//  eya-bench generate [generator options] [-o file.csv]
+//  eya-bench run [generator options] [--repeat N] [--filter name] [--json results.json]
+//  eya-bench scale [--config file] [--reference file] [--update-reference] [--tier name] [--all] [--exe path] [--json results.json]
+//
+
+#include "eya-attendance.h"
+#include "attendance.h"
+#include "csv.h"
+#include "export-generator.h"
+#include "names.h"
+#include "scale-suite.h"
+#include "streak-index.h"
+#include "uring-byte-source.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    // Results the benchmarks fold into this so the compiler can't drop the work
+    volatile uint64_t benchmarkSink{ 0 };
+
+    // How much work one iteration of a benchmark did
+    struct Work
+    {
+        uint64_t rows{ 0 };
+        uint64_t bytes{ 0 };
+    };
+
+    struct BenchmarkResult
+    {
+        std::string name{};
+        uint32_t iterations{ 0 };
+        double best_seconds{ 0 };
+        double median_seconds{ 0 };
+        Work work{};
+    };
+
+    struct BenchOptions
+    {
+        ExportGeneratorOptions generator{};
+        std::string output{};
+        std::string json{};
+        std::string filter{};
+        uint32_t repeat{ 5 };
+    };
+
+    // Run body repeat times (after one warm-up), setup runs untimed before every iteration
+    BenchmarkResult RunBenchmark(const std::string& name, uint32_t repeat, const std::function<void()>& setup, const std::function<Work()>& body)
+    {
+        BenchmarkResult result;
+        result.name = name;
+        result.iterations = repeat;
+
+        setup();
+        body();
+
+        std::vector<double> seconds;
+        for (uint32_t i = 0; i < repeat; ++i)
+        {
+            setup();
+            const auto start = std::chrono::steady_clock::now();
+            result.work = body();
+            seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        std::sort(seconds.begin(), seconds.end());
+        result.best_seconds = seconds.front();
+        result.median_seconds = seconds[seconds.size() / 2];
+        return result;
+    }
+
+    double RowsPerSecond(const BenchmarkResult& r)
+    {
+        return r.median_seconds > 0 ? r.work.rows / r.median_seconds : 0;
+    }
+
+    double MegabytesPerSecond(const BenchmarkResult& r)
+    {
+        return r.median_seconds > 0 ? r.work.bytes / r.median_seconds / (1024.0 * 1024.0) : 0;
+    }
+
+    void PrintResult(const BenchmarkResult& r)
+    {
+        std::cout << std::left << std::setw(36) << r.name
+            << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << r.median_seconds * 1000.0 << " ms"
+            << std::setw(16) << std::setprecision(0) << RowsPerSecond(r) << " rows/s"
+            << std::setw(12) << std::setprecision(1) << MegabytesPerSecond(r) << " MB/s" << std::endl;
+    }
+
+    bool WriteJson(const std::string& path, const BenchOptions& options, uint64_t inputBytes, const std::vector<BenchmarkResult>& results)
+    {
+        std::ofstream out(path);
+        if (!out.good())
+            return false;
+
+        const auto& g = options.generator;
+        out << std::fixed << std::setprecision(6);
+        out << "{\n  \"config\": {\"members\": " << g.members << ", \"sundays\": " << g.sundays
+            << ", \"duplicate_every\": " << g.duplicate_every << ", \"weekday_every\": " << g.weekday_every
+            << ", \"crlf\": " << (g.crlf ? "true" : "false") << ", \"bom\": " << (g.bom ? "true" : "false")
+            << ", \"seed\": " << g.seed << ", \"repeat\": " << options.repeat << ", \"input_bytes\": " << inputBytes << "},\n";
+        out << "  \"results\": [";
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            const auto& r = results[i];
+            out << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+                << ", \"best_s\": " << r.best_seconds << ", \"median_s\": " << r.median_seconds
+                << ", \"rows\": " << r.work.rows << ", \"bytes\": " << r.work.bytes
+                << ", \"rows_per_s\": " << RowsPerSecond(r) << ", \"mb_per_s\": " << MegabytesPerSecond(r) << "}";
+        }
+        out << "\n  ]\n}\n";
+        return out.good();
+    }
+
+    template <std::size_t... I>
+    void ReadHeader(io::CSVReader<100>& in, const std::vector<std::string>& headers, std::index_sequence<I...>)
+    {
+        in.read_header(io::ignore_extra_column | io::ignore_missing_column, headers[I]...);
+    }
+
+    template <std::size_t... I>
+    bool ReadRow(io::CSVReader<100>& in, std::vector<std::string>& data, std::index_sequence<I...>)
+    {
+        return in.read_row(data[I]...);
+    }
+
+    template <std::size_t... I>
+    bool TryReadRow(io::CSVReader<100>& in, io::parse_diagnostics& rejected, std::vector<std::string>& data, std::index_sequence<I...>)
+    {
+        return in.try_read_row(rejected, data[I]...);
+    }
+
+    int RunBenchmarks(const BenchOptions& options)
+    {
+        // Resolve before we move into the scratch directory
+        const std::string jsonPath = options.json.empty() ? "" : std::filesystem::absolute(options.json).string();
+
+        // Generate the input once, in memory and on disk for the stages that take a path
+        std::ostringstream generated;
+        const uint64_t inputBytes = GenerateExport(options.generator, generated);
+        const std::string input = generated.str();
+
+        const auto workDir = std::filesystem::temp_directory_path() / "eya-bench";
+        std::filesystem::create_directories(workDir);
+        const std::string inputPath = (workDir / GeneratedExportFileName(options.generator)).string();
+        {
+            std::ofstream out(inputPath, std::ios::binary);
+            out << input;
+        }
+        std::filesystem::current_path(workDir);
+
+        std::string headerRow;
+        std::vector<std::string> headers;
+        {
+            io::LineReader in("generated", input.data(), input.data() + input.size());
+            eya::Diagnostics diagnostics;
+            if (!GetHeaderRow(in, headerRow) || !TokenizeHeaderRow(headerRow, headers, diagnostics))
+            {
+                std::cout << "Generated export has an unusable header row" << std::endl;
+                return -1;
+            }
+        }
+        const uint32_t actualNumHeaders{ static_cast<uint32_t>(headers.size()) };
+
+        // The generic CSVReader<100> benchmark only fits 98 Sundays, the pipeline itself has no limit
+        const bool fitsCSVReader{ actualNumHeaders <= 100 };
+        std::vector<std::string> paddedHeaders{ headers };
+        paddedHeaders.resize(100);
+
+        // Inputs for the smaller stages
+        std::vector<std::string> headerTokens;
+        {
+            std::istringstream split(headerRow);
+            for (std::string each; std::getline(split, each, ','); headerTokens.push_back(each));
+        }
+        uint64_t headerTokenBytes{ 0 };
+        for (const auto& token : headerTokens)
+            headerTokenBytes += token.size();
+
+        std::vector<std::string> statusCells;
+        uint64_t statusBytes{ 0 };
+        {
+            io::LineReader in("generated", input.data(), input.data() + input.size());
+            in.next_line();
+            while (char* line = in.next_line())
+            {
+                std::istringstream split(line);
+                uint32_t column{ 0 };
+                for (std::string each; std::getline(split, each, ','); ++column)
+                {
+                    if (column >= 3)
+                    {
+                        statusBytes += each.size();
+                        statusCells.push_back(std::move(each));
+                    }
+                }
+            }
+        }
+
+        // The percent column, and wider ids and rates made from it, for the numeric parsers
+        std::vector<std::string> percentCells, idCells, rateCells;
+        uint64_t percentBytes{ 0 }, idBytes{ 0 }, rateBytes{ 0 };
+        {
+            io::LineReader in("generated", input.data(), input.data() + input.size());
+            in.next_line();
+            uint64_t id{ 1000000007 };
+            while (char* line = in.next_line())
+            {
+                std::istringstream split(line);
+                std::string each;
+                for (uint32_t column = 0; column <= 2 && std::getline(split, each, ','); ++column);
+                percentBytes += each.size();
+                id = id * 6364136223846793005 + 1442695040888963407;
+                idCells.push_back(std::to_string(id >> (id % 40)));
+                idBytes += idCells.back().size();
+                std::ostringstream rate;
+                rate << std::fixed << std::setprecision(4) << std::atoi(each.c_str()) / 100.0 + (id % 10000) / 1e8;
+                rateCells.push_back(rate.str());
+                rateBytes += rateCells.back().size();
+                percentCells.push_back(std::move(each));
+            }
+        }
+
+        std::string quotedInput;
+        {
+            std::istringstream lines(input);
+            std::string line;
+            std::getline(lines, line);
+            quotedInput.append(line).append(1, '\n');
+            while (std::getline(lines, line))
+            {
+                const std::size_t first{ line.find(',') };
+                const std::size_t last{ line.find(',', first + 1) };
+                quotedInput.append(1, '"').append(line, 0, first).append("\",\"").append(line, first + 1, last - first - 1).append(1, '"')
+                    .append(line, last, std::string::npos).append(1, '\n');
+            }
+        }
+
+        std::vector<person> classRoll;
+        std::vector<eya::OutreachEntry> outreach;
+        {
+            io::LineReader in(inputPath);
+            in.next_line();
+            if (!CreateClassRollVector(in, headerRow, headers, classRoll))
+            {
+                std::cout << "Failed to create a class roll from the generated export" << std::endl;
+                return -1;
+            }
+        }
+        // Every name on the roll, then the same names spelled with a combining accent, which NameCodec composes the long way
+        std::vector<std::string> nameCells, accentedNameCells;
+        uint64_t nameBytes{ 0 }, accentedNameBytes{ 0 };
+        for (const auto& member : classRoll)
+        {
+            for (const std::string* name : { &member.first_name, &member.last_name })
+            {
+                nameCells.push_back(*name);
+                accentedNameCells.push_back(name->substr(0, 1) + "\xCC\x81" + name->substr(std::min<std::size_t>(1, name->size())));
+                nameBytes += nameCells.back().size();
+                accentedNameBytes += accentedNameCells.back().size();
+            }
+        }
+
+        const uint64_t members{ classRoll.size() };
+        const uint64_t cells{ members * (actualNumHeaders - 2) };
+
+        auto noSetup = [] {};
+        auto wanted = [&](const std::string& name) { return options.filter.empty() || name.find(options.filter) != std::string::npos; };
+        std::vector<BenchmarkResult> results;
+        auto run = [&](const std::string& name, const std::function<void()>& setup, const std::function<Work()>& body)
+            {
+                if (!wanted(name))
+                    return;
+                results.push_back(RunBenchmark(name, options.repeat, setup, body));
+                PrintResult(results.back());
+            };
+
+        std::cout << "Input: " << options.generator.members << " members x " << options.generator.sundays << " Sundays, "
+            << inputBytes << " bytes" << std::endl;
+
+        run("ValidDateFormat", noSetup, [&]
+            {
+                uint64_t valid{ 0 };
+                for (const auto& token : headerTokens)
+                    valid += ValidDateFormat(token) ? 1 : 0;
+                benchmarkSink = valid;
+                return Work{ headerTokens.size(), headerTokenBytes };
+            });
+
+        run("TokenizeHeaderRow", noSetup, [&]
+            {
+                eya::Diagnostics diagnostics;
+                std::vector<std::string> tokens;
+                TokenizeHeaderRow(headerRow, tokens, diagnostics);
+                return Work{ headerTokens.size(), headerRow.size() };
+            });
+
+        run("LineReader::next_line", noSetup, [&]
+            {
+                io::LineReader in("generated", input.data(), input.data() + input.size());
+                uint64_t rows{ 0 };
+                while (in.next_line())
+                    ++rows;
+                return Work{ rows, input.size() };
+            });
+
+        if (fitsCSVReader)
+            run("CSVReader::read_row", noSetup, [&]
+                {
+                    io::CSVReader<100> in("generated", input.data(), input.data() + input.size());
+                    ReadHeader(in, paddedHeaders, std::make_index_sequence<100>{});
+                    std::vector<std::string> data(100);
+                    uint64_t rows{ 0 };
+                    while (ReadRow(in, data, std::make_index_sequence<100>{}))
+                        ++rows;
+                    return Work{ rows, input.size() };
+                });
+
+        if (fitsCSVReader)
+            run("CSVReader::try_read_row", noSetup, [&]
+                {
+                    io::CSVReader<100> in("generated", input.data(), input.data() + input.size());
+                    ReadHeader(in, paddedHeaders, std::make_index_sequence<100>{});
+                    std::vector<std::string> data(100);
+                    io::parse_diagnostics rejected;
+                    uint64_t rows{ 0 };
+                    while (TryReadRow(in, rejected, data, std::make_index_sequence<100>{}))
+                        ++rows;
+                    return Work{ rows, input.size() };
+                });
+
+        run("ClassifyStatus", noSetup, [&]
+            {
+                uint64_t present{ 0 };
+                person::MemberType memberType{ person::MemberType::NA };
+                for (const auto& cell : statusCells)
+                    present += ClassifyStatus(cell, memberType) == person::AttendanceType::PRESENT ? 1 : 0;
+                benchmarkSink = present;
+                return Work{ statusCells.size(), statusBytes };
+            });
+
+        // The csv parser's original one digit at a time loops against the SWAR and std::from_chars fast paths in front of them
+        auto parseAll = [&](const std::vector<std::string>& cells, uint64_t bytes, auto parse)
+            {
+                uint64_t total{ 0 };
+                for (const auto& cell : cells)
+                    total += parse(cell.c_str());
+                benchmarkSink = total;
+                return Work{ cells.size(), bytes };
+            };
+
+        run("detail::parse_signed_integer_loop (percent)", noSetup, [&]
+            {
+                return parseAll(percentCells, percentBytes, [](const char* cell) { int x; io::detail::parse_signed_integer_loop<io::throw_on_overflow>(cell, x); return static_cast<uint64_t>(x); });
+            });
+
+        run("detail::parse_signed_integer (percent)", noSetup, [&]
+            {
+                return parseAll(percentCells, percentBytes, [](const char* cell) { int x; io::detail::parse_signed_integer<io::throw_on_overflow>(cell, x); return static_cast<uint64_t>(x); });
+            });
+
+        run("detail::parse_unsigned_integer_loop (ids)", noSetup, [&]
+            {
+                return parseAll(idCells, idBytes, [](const char* cell) { uint64_t x; io::detail::parse_unsigned_integer_loop<io::throw_on_overflow>(cell, x); return x; });
+            });
+
+        run("detail::parse_unsigned_integer (ids)", noSetup, [&]
+            {
+                return parseAll(idCells, idBytes, [](const char* cell) { uint64_t x; io::detail::parse_unsigned_integer<io::throw_on_overflow>(cell, x); return x; });
+            });
+
+        run("detail::parse_float_loop (rates)", noSetup, [&]
+            {
+                return parseAll(rateCells, rateBytes, [](const char* cell) { double x; io::detail::parse_float_loop(cell, x); return static_cast<uint64_t>(x * 1e8); });
+            });
+
+        run("detail::parse_float (rates)", noSetup, [&]
+            {
+                return parseAll(rateCells, rateBytes, [](const char* cell) { double x; io::detail::parse_float(cell, x); return static_cast<uint64_t>(x * 1e8); });
+            });
+
+        auto cleanAll = [&](std::vector<std::string>& cells, uint64_t bytes)
+            {
+                std::string repaired;
+                uint64_t total{ 0 };
+                for (auto& cell : cells)
+                    total += static_cast<unsigned char>(*NameCodec::clean(cell.data(), cell.data() + cell.size(), repaired));
+                benchmarkSink = total;
+                return Work{ cells.size(), bytes };
+            };
+
+        run("NameCodec::clean", noSetup, [&] { return cleanAll(nameCells, nameBytes); });
+        run("NameCodec::clean (accented)", noSetup, [&] { return cleanAll(accentedNameCells, accentedNameBytes); });
+
+        // Only splitting rows into batches, what every roll builder pays before it does anything with them
+        run("ReadRowBatches", noSetup, [&]
+            {
+                io::LineReader in(inputPath);
+                in.next_line();
+                uint64_t rows{ 0 };
+                for (const RowBatch& batch : ReadRowBatches(in, headerRow, headers))
+                    rows += batch.rows;
+                return Work{ rows, input.size() };
+            });
+
+        run("CreateClassRollVector", noSetup, [&]
+            {
+                io::LineReader in(inputPath);
+                in.next_line();
+                std::vector<person> roll;
+                CreateClassRollVector(in, headerRow, headers, roll);
+                return Work{ roll.size(), input.size() };
+            });
+
+        // The same file read with several blocks in flight through io_uring, where the kernel allows it
+        if (OpenUringByteSource(inputPath))
+            run("CreateClassRollVector (io_uring)", noSetup, [&]
+                {
+                    io::LineReader in(inputPath, OpenUringByteSource(inputPath));
+                    in.next_line();
+                    std::vector<person> roll;
+                    CreateClassRollVector(in, headerRow, headers, roll);
+                    return Work{ roll.size(), input.size() };
+                });
+
+        // The same export with every name quoted, as a spreadsheet saves it, those lines go through quote handling
+        run("CreateClassRollVector (quoted names)", noSetup, [&]
+            {
+                io::LineReader in("quoted", quotedInput.data(), quotedInput.data() + quotedInput.size());
+                in.next_line();
+                std::vector<person> roll;
+                CreateClassRollVector(in, headerRow, headers, roll);
+                return Work{ roll.size(), quotedInput.size() };
+            });
+
+        run("CreateOutreachRoll", noSetup, [&]
+            {
+                io::LineReader in(inputPath);
+                in.next_line();
+                std::vector<person> roll;
+                CreateOutreachRoll(in, headerRow, headers, roll);
+                return Work{ roll.size(), input.size() };
+            });
+
+        // CountAbsentWeeks keeps state on each member, so start every iteration from a fresh roll
+        run("CountAbsentWeeks", [&]
+            {
+                for (auto& member : classRoll)
+                {
+                    member.seen = false;
+                    member.longest_streak = 0;
+                }
+            }, [&]
+            {
+                CountAbsentWeeks(classRoll);
+                return Work{ members, cells * sizeof(person::Attendance) };
+            });
+        CountAbsentWeeks(classRoll);
+
+        const eya::OutreachRules rules;
+        std::vector<eya::OutreachAction> actions;
+        run("EvaluateOutreach", noSetup, [&]
+            {
+                EvaluateOutreach(rules, classRoll, actions);
+                return Work{ members, members * (sizeof(person::Attendance) + sizeof(int32_t) + 1) };
+            });
+        EvaluateOutreach(rules, classRoll, actions);
+        BuildOutreachList(classRoll, actions, outreach);
+
+        // Diff against this run's own state, the join does the same work whatever it finds
+        eya::OutreachState previousState;
+        {
+            std::stringstream state;
+            std::string error;
+            OutputDataToOutreachStateFile(state, classRoll, outreach);
+            ReadOutreachStateFile(state, previousState, error);
+        }
+        run("DiffOutreach", noSetup, [&]
+            {
+                eya::OutreachDelta delta;
+                DiffOutreach(previousState, classRoll, actions, delta);
+                return Work{ members + previousState.size(), 0 };
+            });
+
+        run("ComputeAnalytics", noSetup, [&]
+            {
+                eya::Analytics analytics;
+                ComputeAnalytics(classRoll, analytics);
+                return Work{ members, cells * sizeof(person::Attendance) };
+            });
+
+        eya::Analytics analytics;
+        ComputeAnalytics(classRoll, analytics);
+        std::vector<float> scores;
+        std::vector<int32_t> weeksSinceSeen;
+        run("ScoreAtRisk", noSetup, [&]
+            {
+                ScoreAtRisk(classRoll, analytics, scores, weeksSinceSeen);
+                return Work{ members, members * (sizeof(person::Attendance) + sizeof(eya::MemberRate)) };
+            });
+        run("SelectAtRisk (top 100)", noSetup, [&]
+            {
+                eya::AtRiskRanking ranking;
+                SelectAtRisk(classRoll, scores, weeksSinceSeen, 100, ranking);
+                return Work{ members, members * sizeof(float) };
+            });
+
+        run("ComputeCohorts", noSetup, [&]
+            {
+                eya::Cohorts cohorts;
+                ComputeCohorts(headers, classRoll, cohorts);
+                return Work{ members, cells * sizeof(person::Attendance) };
+            });
+
+        std::vector<int64_t> sundays;
+        for (std::size_t i = 2; i < headers.size(); ++i)
+        {
+            int64_t day{ 0 };
+            ParseHeaderDate(headers[i], day);
+            sundays.push_back(day);
+        }
+
+        run("StreakIndex", noSetup, [&]
+            {
+                const StreakIndex streaks{ classRoll, sundays };
+                return Work{ members, cells * sizeof(person::Attendance) };
+            });
+
+        // Everyone's streak as of the middle Sunday, what /streak?date= does
+        const StreakIndex streaks{ classRoll, sundays };
+        std::vector<int32_t> weeksAbsent;
+        run("StreakIndex::WeeksAbsentAll", noSetup, [&]
+            {
+                streaks.WeeksAbsentAll(static_cast<int32_t>(sundays.size() / 2), weeksAbsent);
+                return Work{ members, streaks.RunCount() * (sizeof(int32_t) * 3) };
+            });
+
+        run("OutputDataToReportFile", noSetup, [&]
+            {
+                {
+                    std::ofstream outFile("report-bench.csv");
+                    OutputDataToReportFile(outFile, headers, classRoll, actions);
+                }
+                return Work{ members, std::filesystem::file_size("report-bench.csv") };
+            });
+
+        // The same stages over the compressed roll, what Pipeline::COMPRESSED runs for rolls too long to keep as person::Attendance
+        run("CreateCompressedRoll", noSetup, [&]
+            {
+                io::LineReader in(inputPath);
+                in.next_line();
+                std::vector<person> roll;
+                AttendanceHistory history;
+                CreateCompressedRoll(in, headerRow, headers, roll, history);
+                return Work{ roll.size(), input.size() };
+            });
+
+        std::vector<person> compressedRoll;
+        AttendanceHistory history;
+        {
+            io::LineReader in(inputPath);
+            in.next_line();
+            CreateCompressedRoll(in, headerRow, headers, compressedRoll, history);
+        }
+        std::vector<eya::OutreachAction> compressedActions;
+        EvaluateOutreach(rules, compressedRoll, compressedActions);
+
+        run("ComputeAnalytics (compressed)", noSetup, [&]
+            {
+                eya::Analytics compressedAnalytics;
+                ComputeAnalytics(compressedRoll, history, compressedAnalytics);
+                return Work{ members, history.MemoryBytes() };
+            });
+
+        run("ComputeCohorts (compressed)", noSetup, [&]
+            {
+                eya::Cohorts compressedCohorts;
+                ComputeCohorts(headers, history, compressedCohorts);
+                return Work{ members, history.MemoryBytes() };
+            });
+
+        run("OutputDataToReportFile (compressed)", noSetup, [&]
+            {
+                {
+                    std::ofstream outFile("report-bench.csv");
+                    OutputDataToReportFile(outFile, headers, compressedRoll, history, compressedActions);
+                }
+                return Work{ members, std::filesystem::file_size("report-bench.csv") };
+            });
+
+        if (wanted("CreateCompressedRoll"))
+        {
+            // Attendance as person keeps it, each cell's date string only counted when it is too long for the small string buffer
+            uint64_t rollBytes{ 0 };
+            for (const auto& member : classRoll)
+            {
+                rollBytes += member.attendance_list.capacity() * sizeof(person::Attendance);
+                for (const auto& attendance : member.attendance_list)
+                    rollBytes += attendance.date.capacity() > 15 ? attendance.date.capacity() + 1 : 0;
+            }
+            std::cout << "Attendance history: " << history.MemoryBytes() << " bytes compressed, " << rollBytes << " bytes as person::Attendance" << std::endl;
+        }
+
+        run("OutputDataToOutreachFile", noSetup, [&]
+            {
+                {
+                    std::ofstream outFile("outreach-bench.csv");
+                    OutputDataToOutreachFile(outFile, classRoll, outreach);
+                }
+                return Work{ members, std::filesystem::file_size("outreach-bench.csv") };
+            });
+
+        // The whole pipeline through the library, straight from memory
+        run("eya::AnalyzeBuffer", noSetup, [&]
+            {
+                eya::AnalysisResult result;
+                eya::Diagnostics diagnostics;
+                eya::AnalyzeBuffer(input.data(), input.size(), inputPath, result, diagnostics);
+                return Work{ result.roll.size(), input.size() };
+            });
+
+        run("eya::AnalyzeBuffer (outreach only)", noSetup, [&]
+            {
+                eya::AnalysisResult result;
+                eya::Diagnostics diagnostics;
+                eya::AnalyzeBuffer(input.data(), input.size(), inputPath, result, diagnostics, nullptr, nullptr, eya::Pipeline::OUTREACH_ONLY);
+                return Work{ result.roll.size(), input.size() };
+            });
+
+        if (!jsonPath.empty())
+        {
+            if (!WriteJson(jsonPath, options, inputBytes, results))
+            {
+                std::cout << "Failed writing " << jsonPath << std::endl;
+                return -1;
+            }
+            std::cout << "Results written to " << jsonPath << std::endl;
+        }
+
+        return 0;
+    }
+
+    // Shared by both commands, returns false on anything it doesn't recognise
+    bool ParseBenchArguments(int argc, char* argv[], BenchOptions& options)
+    {
+        auto& g = options.generator;
+        for (int i = 2; i < argc; ++i)
+        {
+            const std::string arg{ argv[i] };
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--members" && hasValue) g.members = static_cast<uint32_t>(std::stoul(argv[++i]));
+            else if (arg == "--sundays" && hasValue) g.sundays = static_cast<uint32_t>(std::stoul(argv[++i]));
+            else if (arg == "--first-sunday" && hasValue) g.first_sunday = argv[++i];
+            else if (arg == "--leaders" && hasValue) g.leader_share = std::stod(argv[++i]);
+            else if (arg == "--visitors" && hasValue) g.visitor_share = std::stod(argv[++i]);
+            else if (arg == "--attendance" && hasValue) g.attendance_rate = std::stod(argv[++i]);
+            else if (arg == "--late-join" && hasValue) g.late_join_share = std::stod(argv[++i]);
+            else if (arg == "--not-taken" && hasValue) g.not_taken_rate = std::stod(argv[++i]);
+            else if (arg == "--duplicate-every" && hasValue) g.duplicate_every = static_cast<uint32_t>(std::stoul(argv[++i]));
+            else if (arg == "--weekday-every" && hasValue) g.weekday_every = static_cast<uint32_t>(std::stoul(argv[++i]));
+            else if (arg == "--lf") g.crlf = false;
+            else if (arg == "--crlf") g.crlf = true;
+            else if (arg == "--bom") g.bom = true;
+            else if (arg == "--seed" && hasValue) g.seed = std::stoull(argv[++i]);
+            else if (arg == "-o" && hasValue) options.output = argv[++i];
+            else if (arg == "--json" && hasValue) options.json = argv[++i];
+            else if (arg == "--filter" && hasValue) options.filter = argv[++i];
+            else if (arg == "--repeat" && hasValue) options.repeat = std::max(1ul, std::stoul(argv[++i]));
+            else return false;
+        }
+        return true;
+    }
+
+    bool ParseScaleArguments(int argc, char* argv[], ScaleSuiteOptions& options)
+    {
+        for (int i = 2; i < argc; ++i)
+        {
+            const std::string arg{ argv[i] };
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--config" && hasValue) options.config = argv[++i];
+            else if (arg == "--reference" && hasValue) options.reference = argv[++i];
+            else if (arg == "--update-reference") options.update_reference = true;
+            else if (arg == "--tier" && hasValue) options.tier = argv[++i];
+            else if (arg == "--all") options.all = true;
+            else if (arg == "--exe" && hasValue) options.executable = argv[++i];
+            else if (arg == "--json" && hasValue) options.json = argv[++i];
+            else return false;
+        }
+        return true;
+    }
+
+    void PrintUsage()
+    {
+        std::cout << "Usage: eya-bench generate [options] [-o file.csv]\n"
+            "       eya-bench run [options] [--repeat N] [--filter name] [--json results.json]\n"
+            "       eya-bench scale [--config file] [--reference file] [--update-reference] [--tier name] [--all] [--exe path] [--json results.json]\n"
+            "Generator options: --members N --sundays N --first-sunday yyyy-mm-dd --leaders F --visitors F\n"
+            "                   --attendance F --late-join F --not-taken F --duplicate-every N --weekday-every N\n"
+            "                   --lf | --crlf --bom --seed N" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    const std::string command{ argc > 1 ? argv[1] : "" };
+
+    if (command == "scale")
+    {
+        ScaleSuiteOptions scaleOptions;
+        if (!ParseScaleArguments(argc, argv, scaleOptions))
+        {
+            PrintUsage();
+            return -1;
+        }
+        return RunScaleSuite(scaleOptions);
+    }
+
+    bool parsed{ false };
+    try
+    {
+        parsed = ParseBenchArguments(argc, argv, options);
+    }
+    catch (std::exception&)
+    {
+        parsed = false;
+    }
+
+    if (!parsed || (command != "generate" && command != "run"))
+    {
+        PrintUsage();
+        return -1;
+    }
+
+    if (command == "generate")
+    {
+        const std::string path = options.output.empty() ? GeneratedExportFileName(options.generator) : options.output;
+        std::ofstream out(path, std::ios::binary);
+        if (!out.good())
+        {
+            std::cout << "Failed opening " << path << std::endl;
+            return -1;
+        }
+        const uint64_t bytes = GenerateExport(options.generator, out);
+        std::cout << "Wrote " << bytes << " bytes to " << path << std::endl;
+        return 0;
+    }
+
+    return RunBenchmarks(options);
+}
@@ -0,0 +1,398 @@
+// scale-suite.cpp : Runs the full eya-attendance pipeline at several sizes with RSS, time and output checks
+//
+
+#include "scale-suite.h"
+#include "export-generator.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // One line of the suite config
+    struct ScaleTier
+    {
+        std::string name{};
+        uint32_t members{ 0 };
+        uint32_t sundays{ 0 };
+        double max_rss_mb{ 0 };
+        double max_seconds{ 0 };
+        bool optional{ false };
+    };
+
+    // The output files a tier is checked on, by what their names start with, in reference file order
+    constexpr std::string_view digestedOutputs[] = { "report-", "outreach-", "analytics-", "cohorts-", "outreach-state-" };
+    constexpr std::size_t digestedCount{ std::size(digestedOutputs) };
+
+    struct FileDigest
+    {
+        uint64_t hash{ 0 };
+        uint64_t bytes{ 0 };
+
+        bool operator==(const FileDigest& other) const = default;
+    };
+
+    // Hashes and sizes of each digested output file for a tier
+    struct OutputDigest
+    {
+        FileDigest files[digestedCount];
+
+        bool operator==(const OutputDigest& other) const = default;
+    };
+
+    struct ChildResult
+    {
+        bool started{ false };
+        int exit_code{ -1 };
+        double seconds{ 0 };
+        uint64_t peak_rss_bytes{ 0 };
+    };
+
+    // "# name members sundays max_rss_mb max_seconds [optional]"
+    bool LoadTiers(const std::string& path, std::vector<ScaleTier>& tiers)
+    {
+        std::ifstream in(path);
+        if (!in.good())
+            return false;
+
+        for (std::string line; std::getline(in, line);)
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::istringstream fields(line);
+            ScaleTier tier;
+            std::string flag;
+            if (!(fields >> tier.name >> tier.members >> tier.sundays >> tier.max_rss_mb >> tier.max_seconds))
+                continue;
+            tier.optional = (fields >> flag) && flag == "optional";
+            tiers.push_back(tier);
+        }
+        return !tiers.empty();
+    }
+
+    // "name" then "hash bytes" for each of digestedOutputs, hashes in hex
+    std::map<std::string, OutputDigest> LoadReference(const std::string& path)
+    {
+        std::map<std::string, OutputDigest> reference;
+        std::ifstream in(path);
+        for (std::string line; std::getline(in, line);)
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::istringstream fields(line);
+            std::string name;
+            OutputDigest digest;
+            fields >> name;
+            for (auto& file : digest.files)
+                fields >> std::hex >> file.hash >> std::dec >> file.bytes;
+            if (fields)
+                reference[name] = digest;
+        }
+        return reference;
+    }
+
+    bool SaveReference(const std::string& path, const std::map<std::string, OutputDigest>& reference)
+    {
+        std::ofstream out(path);
+        if (!out.good())
+            return false;
+
+        out << "# Output digests of a reference run, regenerate with: eya-bench scale --all --update-reference\n";
+        out << "# tier then fnv1a and bytes for each of report outreach analytics cohorts outreach-state (CR bytes excluded)\n";
+        for (const auto& [name, digest] : reference)
+        {
+            out << name;
+            for (const auto& file : digest.files)
+                out << " " << std::hex << std::setw(16) << std::setfill('0') << file.hash << " " << std::dec << file.bytes;
+            out << "\n";
+        }
+        return out.good();
+    }
+
+    // 64-bit FNV-1a of a whole file, streamed so the large tiers don't need the output in memory
+    //  The writers use text mode, so CR bytes are skipped to let Windows and Linux runs share one reference
+    bool HashFile(const std::filesystem::path& path, uint64_t& hash, uint64_t& bytes)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.good())
+            return false;
+
+        hash = 0xcbf29ce484222325ull;
+        bytes = 0;
+        std::vector<char> buffer(1 << 20);
+        while (in)
+        {
+            in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            const auto n = static_cast<std::size_t>(in.gcount());
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                if (buffer[i] == '\r')
+                    continue;
+                hash ^= static_cast<unsigned char>(buffer[i]);
+                hash *= 0x100000001b3ull;
+                ++bytes;
+            }
+        }
+        return true;
+    }
+
+    // Run the executable to completion in workDir, stdin empty so PrintMessageAndWait returns, console output to console.txt
+    ChildResult RunChild(const std::string& executable, const std::string& argument, const std::filesystem::path& workDir)
+    {
+        ChildResult result;
+        const auto start = std::chrono::steady_clock::now();
+        const std::string consolePath = (workDir / "console.txt").string();
+
+#ifdef _WIN32
+        SECURITY_ATTRIBUTES inherit{ sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+        HANDLE nul = CreateFileA("NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, &inherit, OPEN_EXISTING, 0, nullptr);
+        HANDLE console = CreateFileA(consolePath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &inherit, CREATE_ALWAYS, 0, nullptr);
+
+        STARTUPINFOA startup{};
+        startup.cb = sizeof(startup);
+        startup.dwFlags = STARTF_USESTDHANDLES;
+        startup.hStdInput = nul;
+        startup.hStdOutput = console;
+        startup.hStdError = console;
+
+        PROCESS_INFORMATION process{};
+        std::string commandLine = "\"" + executable + "\" \"" + argument + "\"";
+        const std::string directory = workDir.string();
+        if (CreateProcessA(nullptr, commandLine.data(), nullptr, nullptr, TRUE, 0, nullptr, directory.c_str(), &startup, &process))
+        {
+            result.started = true;
+            WaitForSingleObject(process.hProcess, INFINITE);
+
+            DWORD code{ 0 };
+            GetExitCodeProcess(process.hProcess, &code);
+            result.exit_code = static_cast<int>(code);
+
+            PROCESS_MEMORY_COUNTERS counters{};
+            if (GetProcessMemoryInfo(process.hProcess, &counters, sizeof(counters)))
+                result.peak_rss_bytes = counters.PeakWorkingSetSize;
+
+            CloseHandle(process.hThread);
+            CloseHandle(process.hProcess);
+        }
+        CloseHandle(nul);
+        CloseHandle(console);
+#else
+        const pid_t pid = fork();
+        if (pid == 0)
+        {
+            if (chdir(workDir.c_str()) != 0)
+                _exit(127);
+            const int in = open("/dev/null", O_RDONLY);
+            const int out = open(consolePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            dup2(in, STDIN_FILENO);
+            dup2(out, STDOUT_FILENO);
+            dup2(out, STDERR_FILENO);
+            execl(executable.c_str(), executable.c_str(), argument.c_str(), static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        if (pid > 0)
+        {
+            // wait4 gives the child's own rusage, ru_maxrss is in kilobytes on Linux and bytes on macOS
+            int status{ 0 };
+            rusage usage{};
+            if (wait4(pid, &status, 0, &usage) == pid)
+            {
+                result.started = !(WIFEXITED(status) && WEXITSTATUS(status) == 127);
+                result.exit_code = WIFEXITED(status) ? static_cast<int8_t>(WEXITSTATUS(status)) : -1;
+#ifdef __APPLE__
+                result.peak_rss_bytes = static_cast<uint64_t>(usage.ru_maxrss);
+#else
+                result.peak_rss_bytes = static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+            }
+        }
+#endif
+
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    std::string ExecutablePath(const ScaleSuiteOptions& options)
+    {
+        if (!options.executable.empty())
+            return std::filesystem::absolute(options.executable).string();
+#ifdef _WIN32
+        char self[MAX_PATH]{};
+        GetModuleFileNameA(nullptr, self, MAX_PATH);
+        return (std::filesystem::path(self).parent_path() / "eya-attendance.exe").string();
+#else
+        std::error_code ec;
+        const auto self = std::filesystem::read_symlink("/proc/self/exe", ec);
+        return ((ec ? std::filesystem::current_path() : self.parent_path()) / "eya-attendance").string();
+#endif
+    }
+}
+
+int RunScaleSuite(const ScaleSuiteOptions& options)
+{
+    std::vector<ScaleTier> tiers;
+    if (!LoadTiers(options.config, tiers))
+    {
+        std::cout << "Failed loading scale tiers from " << options.config << std::endl;
+        return -1;
+    }
+
+    const std::string executable = ExecutablePath(options);
+    if (!std::filesystem::exists(executable))
+    {
+        std::cout << "Can't find the eya-attendance executable at " << executable << ", pass --exe" << std::endl;
+        return -1;
+    }
+
+    auto reference = LoadReference(options.reference);
+    const std::string jsonPath = options.json.empty() ? "" : std::filesystem::absolute(options.json).string();
+    const auto suiteDir = std::filesystem::temp_directory_path() / "eya-scale";
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(3) << "{\n  \"tiers\": [";
+    bool first{ true };
+    int failures{ 0 };
+
+    std::cout << std::left << std::setw(10) << "Tier" << std::right << std::setw(10) << "Members" << std::setw(9) << "Sundays"
+        << std::setw(12) << "Seconds" << std::setw(10) << "Max" << std::setw(12) << "Peak MB" << std::setw(10) << "Max"
+        << std::setw(12) << "Output" << "  Result" << std::endl;
+
+    for (const auto& tier : tiers)
+    {
+        const bool selected = options.tier.empty() ? (!tier.optional || options.all) : tier.name == options.tier;
+        if (!selected)
+            continue;
+
+        // Fresh directory per tier so only this run's outputs are hashed
+        const auto workDir = suiteDir / tier.name;
+        std::error_code ec;
+        std::filesystem::remove_all(workDir, ec);
+        std::filesystem::create_directories(workDir);
+
+        ExportGeneratorOptions generator;
+        generator.members = tier.members;
+        generator.sundays = tier.sundays;
+        const std::string inputName = GeneratedExportFileName(generator);
+        {
+            std::ofstream out(workDir / inputName, std::ios::binary);
+            GenerateExport(generator, out);
+            if (!out.good())
+            {
+                std::cout << tier.name << ": failed writing the generated export" << std::endl;
+                ++failures;
+                continue;
+            }
+        }
+
+        const ChildResult run = RunChild(executable, inputName, workDir);
+        const double peakMb = run.peak_rss_bytes / (1024.0 * 1024.0);
+
+        // Outputs are named after the last date in the file name, find them rather than rebuilding the name
+        //  The date has to follow the prefix straight away, outreach-state- and outreach-delta- are other files
+        const auto dated = [](const std::string& name, std::string_view prefix)
+            {
+                return name.starts_with(prefix) && name.size() > prefix.size() && std::isdigit(static_cast<unsigned char>(name[prefix.size()]));
+            };
+        OutputDigest digest;
+        bool have[digestedCount]{};
+        for (const auto& entry : std::filesystem::directory_iterator(workDir))
+        {
+            const std::string name = entry.path().filename().string();
+            for (std::size_t i = 0; i < digestedCount; ++i)
+            {
+                if (dated(name, digestedOutputs[i]))
+                    have[i] = HashFile(entry.path(), digest.files[i].hash, digest.files[i].bytes);
+            }
+        }
+        const bool haveOutputs = std::all_of(std::begin(have), std::end(have), [](bool each) { return each; });
+
+        std::string outputCheck;
+        bool outputOk{ haveOutputs };
+        if (!haveOutputs)
+        {
+            outputCheck = "missing";
+        }
+        else if (options.update_reference)
+        {
+            reference[tier.name] = digest;
+            outputCheck = "recorded";
+        }
+        else if (auto found = reference.find(tier.name); found == reference.end())
+        {
+            // Nothing to compare against isn't a pass, record one with --update-reference from a build that is trusted
+            outputOk = false;
+            outputCheck = "no ref";
+        }
+        else
+        {
+            outputOk = found->second == digest;
+            outputCheck = outputOk ? "identical" : "DIFFERS";
+        }
+
+        const bool timeOk = run.seconds <= tier.max_seconds;
+        const bool rssOk = peakMb <= tier.max_rss_mb;
+        const bool passed = run.started && run.exit_code == 0 && timeOk && rssOk && outputOk;
+        failures += passed ? 0 : 1;
+
+        std::cout << std::left << std::setw(10) << tier.name << std::right << std::setw(10) << tier.members << std::setw(9) << tier.sundays
+            << std::fixed << std::setprecision(2)
+            << std::setw(12) << run.seconds << std::setw(10) << tier.max_seconds
+            << std::setprecision(1) << std::setw(12) << peakMb << std::setw(10) << tier.max_rss_mb
+            << std::setw(12) << outputCheck << "  " << (passed ? "PASS" : "FAIL");
+        if (!run.started)
+            std::cout << " (could not start " << executable << ")";
+        else if (run.exit_code != 0)
+            std::cout << " (exit code " << run.exit_code << ", see " << (workDir / "console.txt").string() << ")";
+        else if (outputCheck == "no ref")
+            std::cout << " (no digest for " << tier.name << " in " << options.reference << ")";
+        std::cout << std::endl;
+
+        json << (first ? "\n" : ",\n") << "    {\"tier\": \"" << tier.name << "\", \"members\": " << tier.members
+            << ", \"sundays\": " << tier.sundays << ", \"exit_code\": " << run.exit_code
+            << ", \"seconds\": " << run.seconds << ", \"max_seconds\": " << tier.max_seconds
+            << ", \"peak_rss_mb\": " << peakMb << ", \"max_rss_mb\": " << tier.max_rss_mb
+            << ", \"output\": \"" << outputCheck << "\", \"passed\": " << (passed ? "true" : "false") << "}";
+        first = false;
+    }
+    json << "\n  ]\n}\n";
+
+    if (options.update_reference && !SaveReference(options.reference, reference))
+    {
+        std::cout << "Failed writing " << options.reference << std::endl;
+        ++failures;
+    }
+
+    if (!jsonPath.empty())
+    {
+        std::ofstream out(jsonPath);
+        out << json.str();
+    }
+
+    std::cout << (failures ? std::to_string(failures) + " tier(s) failed" : "All tiers passed") << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+
+// End-to-end scale runs of the eya-attendance executable on generated exports
+//  Each tier checks peak RSS and wall time against its ceilings, and the outputs against a recorded reference run
+
+struct ScaleSuiteOptions
+{
+	std::string config{ "bench/scale-suite.txt" };
+	std::string reference{ "bench/scale-reference.txt" };
+	std::string executable{};   // defaults to eya-attendance next to eya-bench
+	std::string tier{};         // run only this tier (optional tiers included)
+	std::string json{};
+	bool all{ false };          // include the optional tiers
+	bool update_reference{ false };
+};
+
+// Returns 0 when every tier that ran passed
+int RunScaleSuite(const ScaleSuiteOptions& options);
@@ -0,0 +1,102 @@
+#pragma once
+#include "person.h"
+#include <cstdint>
+#include <vector>
+
+// Everyone's attendance statuses, compressed member by member, for keeping years of exports in memory
+//  Most rows are long runs of one status, years of "membership removed" before joining or long streaks of "attended as member",
+//  those are stored as runs, anyone who changes status too often for runs to pay off is packed two statuses to a byte
+//  A cell costs a few bits instead of person::Attendance and its date string, the dates are the export's headers
+//  This is what Pipeline::COMPRESSED keeps in place of every member's attendance_list
+
+class AttendanceHistory
+{
+public:
+	enum class Container : uint8_t
+	{
+		RUNS,   // a byte per run, status in the top 3 bits, length - 1 in the low 4 with bit 4 set when more length bytes follow
+		PACKED, // a status per nibble, low nibble first
+	};
+
+	// A cell's status is its attendance type, or LEADING when they were there as a leader, so headcounts can still tell
+	//  members and leaders apart
+	static constexpr uint8_t LEADING{ 5 };
+	static uint8_t Status(person::AttendanceType type, person::MemberType attendedAs)
+	{
+		return type == person::AttendanceType::PRESENT && attendedAs == person::MemberType::LEADER ? LEADING : static_cast<uint8_t>(type);
+	}
+
+	// Compress one member's statuses, whichever container is smaller, returns the one chosen
+	Container Add(const uint8_t* statuses, uint32_t columns);
+
+	// Decompress one member on the fly, visit(type) for each column in order, LEADING comes out as PRESENT
+	template <class Visit>
+	void ForEach(uint32_t member, Visit&& visit) const;
+
+	// The same with the statuses as they were added, visit(status)
+	template <class Visit>
+	void ForEachStatus(uint32_t member, Visit&& visit) const;
+
+	uint32_t MemberCount() const { return static_cast<uint32_t>(entries.size()); }
+	uint32_t Columns(uint32_t member) const { return entries[member].columns; }
+	Container ContainerOf(uint32_t member) const { return entries[member].container; }
+
+	// Heap bytes held, the whole point of the thing
+	std::size_t MemoryBytes() const { return entries.capacity() * sizeof(Entry) + data.capacity(); }
+
+	void ShrinkToFit();
+
+private:
+	struct Entry
+	{
+		uint32_t offset;
+		uint32_t columns;
+		Container container;
+	};
+
+	std::vector<Entry> entries;
+	std::vector<uint8_t> data;
+};
+
+template <class Visit>
+void AttendanceHistory::ForEach(uint32_t member, Visit&& visit) const
+{
+	ForEachStatus(member, [&](uint8_t status)
+		{
+			visit(status == LEADING ? person::AttendanceType::PRESENT : static_cast<person::AttendanceType>(status));
+		});
+}
+
+template <class Visit>
+void AttendanceHistory::ForEachStatus(uint32_t member, Visit&& visit) const
+{
+	const Entry& entry{ entries[member] };
+	const uint8_t* p{ data.data() + entry.offset };
+	if (entry.container == Container::PACKED)
+	{
+		for (uint32_t column = 0; column < entry.columns; ++column)
+			visit(static_cast<uint8_t>((p[column / 2] >> (column % 2 * 4)) & 0x0f));
+		return;
+	}
+
+	for (uint32_t column = 0; column < entry.columns;)
+	{
+		const uint8_t head{ *p++ };
+		const uint8_t status{ static_cast<uint8_t>(head >> 5) };
+		uint32_t length{ head & 0x0fu };
+		if (head & 0x10)
+		{
+			// LEB128 for the rest of the length
+			for (unsigned shift = 4;; shift += 7)
+			{
+				const uint8_t more{ *p++ };
+				length |= static_cast<uint32_t>(more & 0x7f) << shift;
+				if (!(more & 0x80))
+					break;
+			}
+		}
+
+		for (uint32_t end = column + length + 1; column < end; ++column)
+			visit(status);
+	}
+}
@@ -0,0 +1,201 @@
+#pragma once
+#include "attendance-history.h"
+#include "eya-attendance.h"
+#include "generator.h"
+#include "person.h"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace io
+{
+	class LineReader;
+	class parse_diagnostics;
+}
+
+// The attendance pipeline stages, eya::Analyze* runs these in order
+
+// Parse a header date, m/d/yyyy with any single character between the fields, into a day number (see dates.h)
+bool ParseHeaderDate(const std::string& date, int64_t& day);
+
+// Validates an input string is in a valid date format and is a Sunday
+bool ValidDateFormat(const std::string& date);
+
+// Validates an input file path is a valid file and has a .csv extension, .csv.gz and .csv.zst when this build can decompress them
+bool IsValidCSV(const std::string& filePath, eya::Diagnostics& diagnostics);
+
+// From an input file path, scrub the file name for the date
+bool ScrubDateFromFileName(const std::string& filePath, std::string& date);
+
+// Retrieve the first row, "header row", from the csv, the line reader drops a UTF-8 BOM and a trailing '\r'
+bool GetHeaderRow(io::LineReader& in, std::string& headerRow);
+
+// ValidDateFormat results by header text, exports from the same group repeat most of their dates
+//  Kept in eya::AnalysisCache so a long-running process only parses each date once
+class SundayTable
+{
+public:
+	bool IsValidSunday(const std::string& date);
+	std::size_t Size() const;
+
+private:
+	mutable std::shared_mutex lock;
+	std::unordered_map<std::string, bool> sundays;
+};
+
+// Everyone seen in any export so far, by name
+class MemberIndex
+{
+public:
+	// Add everyone in the roll, returns how many weren't in the index yet
+	uint32_t Update(const std::vector<person>& classRoll);
+	std::size_t Size() const;
+
+private:
+	mutable std::shared_mutex lock;
+	std::unordered_map<std::string, uint32_t> members;
+};
+
+// Tokenize the header row, assuming comma separation, into a vector of headers
+//  Dates are checked through sundays when one is given
+bool TokenizeHeaderRow(const std::string& headerRow, std::vector<std::string>& headers, eya::Diagnostics& diagnostics, SundayTable* sundays = nullptr);
+
+// Every status the export uses as a one byte code, decoded by io::schema_reader as it splits each row
+//  The low 3 bits are the attendance type, the next 2 the member type it says they attended as plus one, 0 when it doesn't say
+struct StatusCodec
+{
+	// A status exactly as the export writes it, returning where the cell ends, nullptr for anything else
+	static const char* match(const char* begin, char sep, uint8_t& code);
+
+	// Any status, trimmed
+	static uint8_t decode(const char* begin, const char* end);
+
+	// The attendance type, updating memberType when the code says how they attended
+	static person::AttendanceType Apply(uint8_t code, person::MemberType& memberType)
+	{
+		if (code >> 3)
+			memberType = static_cast<person::MemberType>((code >> 3) - 1);
+		return static_cast<person::AttendanceType>(code & 7);
+	}
+
+	// What the code says they attended as, NA when it doesn't say
+	static person::MemberType AttendedAs(uint8_t code)
+	{
+		return code >> 3 ? static_cast<person::MemberType>((code >> 3) - 1) : person::MemberType::NA;
+	}
+};
+
+// Convert one attendance cell into an attendance type, updating memberType when the cell says how they attended
+person::AttendanceType ClassifyStatus(std::string_view status, person::MemberType& memberType);
+
+// Rows of the export parsed a batch at a time, laid out flat so a batch stays in cache while a stage works through it
+//  Row r's names are FirstName(r) and LastName(r), its percent cell percents[r] (-1 when it isn't a number), and Codes(r)[i]
+//  the StatusCodec code under headers[i + 2]
+struct RowBatch
+{
+	uint32_t rows{ 0 };
+	uint32_t columns{ 0 };            // status codes per row, one for each Sunday
+	std::vector<uint8_t> codes;       // row after row, columns each
+	std::vector<int32_t> percents;
+	std::string names;                // every name back to back
+	std::vector<uint32_t> name_ends;  // where each name ends in names, first then last for each row
+
+	std::string_view FirstName(uint32_t row) const { return Name(2 * row); }
+	std::string_view LastName(uint32_t row) const { return Name(2 * row + 1); }
+	const uint8_t* Codes(uint32_t row) const { return codes.data() + std::size_t{ row } * columns; }
+
+private:
+	std::string_view Name(uint32_t index) const
+	{
+		const uint32_t begin{ index ? name_ends[index - 1] : 0 };
+		return std::string_view{ names }.substr(begin, name_ends[index] - begin);
+	}
+};
+
+// Every row after the header row, a batch at a time, the roll builders below are loops over these
+//  The column count comes from the header row, so there is no limit on the number of Sundays, and quoted cells are unquoted
+//  A row with the wrong number of columns is skipped and recorded in rejected, a failure reading the input is thrown out of the loop
+//  in, headerRow and headers must outlive the loop, and a batch is only valid until the loop moves on to the next
+Generator<RowBatch> ReadRowBatches(io::LineReader& in, const std::string& headerRow, const std::vector<std::string>& headers,
+	io::parse_diagnostics* rejected = nullptr);
+
+// Use the rest of the line reader (after the header row) and the headers to create a roll vector containing everyone's attendance
+//  Rows that don't split into the header's columns are skipped and recorded in rejected when given, the rest of the file is still read
+bool CreateClassRollVector(io::LineReader& in, const std::string& headerRow, const std::vector<std::string>& headers, std::vector<person>& classRoll,
+	io::parse_diagnostics* rejected = nullptr);
+
+// The same, with everyone's attendance straight into history and nobody's ever held uncompressed, each member's attendance_list
+//  holds just the last Sunday with its weeks absent, as CreateOutreachRoll leaves it, history member i is classRoll[i]
+bool CreateCompressedRoll(io::LineReader& in, const std::string& headerRow, const std::vector<std::string>& headers, std::vector<person>& classRoll,
+	AttendanceHistory& history, io::parse_diagnostics* rejected = nullptr);
+
+// Only what the outreach file needs, in one pass over each row, each member's attendance_list holds just the last Sunday
+bool CreateOutreachRoll(io::LineReader& in, const std::string& headerRow, const std::vector<std::string>& headers, std::vector<person>& classRoll,
+	io::parse_diagnostics* rejected = nullptr);
+
+// Under --perf, run LineReader::next_line and RollReader::parse on their own so their counters aren't mixed in with building the roll
+//  headers are the export's, as TokenizeHeaderRow left them
+void MeasureParserStages(const std::string& filePath, const std::vector<std::string>& headers, eya::Diagnostics& diagnostics);
+
+// For each person in the roll, iterate over all days and keep a running total of weeks absent, resetting when appropriate
+bool CountAbsentWeeks(std::vector<person>& classRoll);
+
+// Everyone's action this week from the rules, based on the last Sunday's weeks absent
+//  The roll is gathered into columns first so the rules see the whole roll in one pass
+void EvaluateOutreach(const eya::OutreachRules& rules, const std::vector<person>& classRoll, std::vector<eya::OutreachAction>& actions);
+
+// Everyone in the roll with an action this week
+void BuildOutreachList(const std::vector<person>& classRoll, const std::vector<eya::OutreachAction>& actions, std::vector<eya::OutreachEntry>& outreach);
+
+// Per Sunday headcounts, per member rates and rolling averages, from one pass over the status matrix
+bool ComputeAnalytics(const std::vector<person>& classRoll, eya::Analytics& analytics);
+bool ComputeAnalytics(const std::vector<person>& classRoll, const AttendanceHistory& history, eya::Analytics& analytics);
+
+// Group everyone by the month they were first seen and count who attended in each month after, in one pass over the roll
+//  Large rolls are split across worker threads, each counting into its own matrix, and the matrices summed at the end
+bool ComputeCohorts(const std::vector<std::string>& headers, const std::vector<person>& classRoll, eya::Cohorts& cohorts);
+bool ComputeCohorts(const std::vector<std::string>& headers, const AttendanceHistory& history, eya::Cohorts& cohorts);
+
+// Read back an outreach state file, returns false with the line at fault
+bool ReadOutreachStateFile(std::istream& in, eya::OutreachState& state, std::string& error);
+
+// What changed since the previous run's state, a hash join on name and occurrence, built on the previous list and probed with the roll
+void DiffOutreach(const eya::OutreachState& previous, const std::vector<person>& classRoll, const std::vector<eya::OutreachAction>& actions, eya::OutreachDelta& delta);
+
+// Everyone's at-risk score, -1 for anyone who isn't a candidate (there last Sunday, or gone half a year or more)
+void ScoreAtRisk(const std::vector<person>& classRoll, const eya::Analytics& analytics, std::vector<float>& scores, std::vector<int32_t>& weeksSinceSeen);
+void ScoreAtRisk(const std::vector<person>& classRoll, const AttendanceHistory& history, const eya::Analytics& analytics, std::vector<float>& scores,
+	std::vector<int32_t>& weeksSinceSeen);
+
+// The k highest scores, highest first with ties in roll order, a partial selection rather than a sort of the whole roll
+void SelectAtRisk(const std::vector<person>& classRoll, const std::vector<float>& scores, const std::vector<int32_t>& weeksSinceSeen, std::size_t k, eya::AtRiskRanking& ranking);
+
+// Create an overall report file, this is basically a better version of the planning center output
+bool OutputDataToReportFile(std::ostream& outFile, const std::vector<std::string>& headers, const std::vector<person>& classRoll, const std::vector<eya::OutreachAction>& actions);
+
+// The same from a compressed roll, weeks absent are worked out again from history while each member's row is written
+bool OutputDataToReportFile(std::ostream& outFile, const std::vector<std::string>& headers, const std::vector<person>& classRoll, const AttendanceHistory& history,
+	const std::vector<eya::OutreachAction>& actions);
+
+// Create an output report file, this is a brief report that tells who needs to be reached out to based on number of absences
+bool OutputDataToOutreachFile(std::ostream& outFile, const std::vector<person>& classRoll, const std::vector<eya::OutreachEntry>& outreach);
+
+// Create an analytics report file, headcounts for each Sunday then each member's rate next to the export's percent
+bool OutputDataToAnalyticsFile(std::ostream& outFile, const std::vector<std::string>& headers, const std::vector<person>& classRoll, const eya::Analytics& analytics);
+
+// Create a cohort report file, retention by months since first seen, then 3, 6 and 12 months against the same cohort a year earlier
+bool OutputDataToCohortFile(std::ostream& outFile, const eya::Cohorts& cohorts);
+
+// Create a ranked outreach file, the at-risk ranking with what the rules say to do about each of them
+bool OutputDataToAtRiskFile(std::ostream& outFile, const std::vector<person>& classRoll, const std::vector<eya::OutreachAction>& actions, const eya::AtRiskRanking& ranking);
+
+// Create an outreach state file, everyone on this run's outreach list with their action, for the next run to diff against
+bool OutputDataToOutreachStateFile(std::ostream& outFile, const std::vector<person>& classRoll, const std::vector<eya::OutreachEntry>& outreach);
+
+// Create an outreach delta file, only the people whose outreach changed since the previous run
+bool OutputDataToOutreachDeltaFile(std::ostream& outFile, const eya::OutreachDelta& delta);
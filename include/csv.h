@@ -34,6 +34,9 @@
 #define CSV_H
 
 #include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <exception>
@@ -42,9 +45,19 @@
 #include <vector>
 #ifndef CSV_IO_NO_THREAD
 #include <condition_variable>
+#include <deque>
+#include <functional>
 #include <mutex>
 #include <thread>
 #endif
+
+// DEVIATION FROM THE LIBRARY!! Compressed inputs, LineReader(file_name) decompresses .gz and .zst files as it reads them
+#ifdef CSV_IO_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CSV_IO_WITH_ZSTD
+#include <zstd.h>
+#endif
 #include <cassert>
 #include <cerrno>
 #include <istream>
@@ -119,6 +132,14 @@ namespace io {
             }
         };
 
+        // DEVIATION FROM THE LIBRARY!! A compressed input that is corrupt or cut short
+        struct decompression_failed : base, with_file_name {
+            void format_error_message() const override {
+                std::snprintf(error_message_buffer, sizeof(error_message_buffer),
+                    "The compressed file \"%s\" is corrupt or cut short.", file_name);
+            }
+        };
+
         struct line_length_limit_exceeded : base, with_file_name, with_file_line {
             void format_error_message() const override {
                 std::snprintf(
@@ -135,7 +156,154 @@ namespace io {
         virtual ~ByteSourceBase() {}
     };
 
+#ifndef CSV_IO_NO_THREAD
+    // DEVIATION FROM THE LIBRARY!! One read service for the process, instead of a thread and a 3MB buffer per LineReader
+    // A fixed set of reader threads does every LineReader's read-ahead, one block read per job in the order asked for,
+    // and line buffers come from a shared pool, kept for the next LineReader rather than freed
+    // The pool's total size is capped, a LineReader opened with the cap reached waits for another to close, so a thread
+    // should hold one LineReader at a time when the cap is lower than the readers it runs at once would need
+    class read_service {
+    public:
+        static const std::size_t buffer_len = 3 << 20;
+
+        static read_service& instance() {
+            static read_service service;
+            return service;
+        }
+
+        read_service(const read_service&) = delete;
+        read_service& operator=(const read_service&) = delete;
+
+        // threads only counts until the first read-ahead starts them, 0 leaves either as it is
+        void configure(unsigned threads, std::size_t max_buffered_bytes) {
+            std::unique_lock<std::mutex> guard(lock);
+            if (threads != 0)
+                thread_count = threads;
+            if (max_buffered_bytes != 0)
+                max_bytes = max_buffered_bytes;
+            while (allocated > max_bytes && !free_buffers.empty()) {
+                free_buffers.pop_back();
+                allocated -= buffer_len;
+            }
+            buffer_returned.notify_all();
+        }
+
+        // A buffer_len buffer, waiting while the cap is reached, the first is always allowed
+        std::unique_ptr<char[]> acquire() {
+            std::unique_lock<std::mutex> guard(lock);
+            buffer_returned.wait(guard, [&] {
+                return !free_buffers.empty() || allocated == 0 || allocated + buffer_len <= max_bytes;
+                });
+            if (!free_buffers.empty()) {
+                std::unique_ptr<char[]> buffer = std::move(free_buffers.back());
+                free_buffers.pop_back();
+                return buffer;
+            }
+            allocated += buffer_len;
+            guard.unlock();
+            try {
+                return std::unique_ptr<char[]>(new char[buffer_len]);
+            }
+            catch (...) {
+                release(nullptr);
+                throw;
+            }
+        }
+
+        void release(std::unique_ptr<char[]> buffer) {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                if (buffer != nullptr && allocated <= max_bytes)
+                    free_buffers.push_back(std::move(buffer));
+                else
+                    allocated -= buffer_len;
+            }
+            buffer_returned.notify_one();
+        }
+
+        // Jobs must catch their own exceptions
+        void submit(std::function<void()> job) {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                if (workers.empty()) {
+                    for (unsigned i = 0; i < thread_count; ++i)
+                        workers.emplace_back([this] { run(); });
+                }
+                jobs.push_back(std::move(job));
+            }
+            job_ready.notify_one();
+        }
+
+        ~read_service() {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                stopping = true;
+            }
+            job_ready.notify_all();
+            for (auto& worker : workers)
+                worker.join();
+        }
+
+    private:
+        read_service() = default;
+
+        void run() {
+            std::unique_lock<std::mutex> guard(lock);
+            for (;;) {
+                job_ready.wait(guard, [&] { return stopping || !jobs.empty(); });
+                if (jobs.empty())
+                    return;
+                std::function<void()> job = std::move(jobs.front());
+                jobs.pop_front();
+                guard.unlock();
+                job();
+                guard.lock();
+            }
+        }
+
+        // Reads mostly wait on the disk, a couple of threads keep a handful of files ahead
+        unsigned thread_count = 2;
+        std::size_t max_bytes = 64 << 20;
+        std::size_t allocated = 0;
+        std::vector<std::unique_ptr<char[]>> free_buffers;
+        std::deque<std::function<void()>> jobs;
+        std::vector<std::thread> workers;
+        bool stopping = false;
+        std::mutex lock;
+        std::condition_variable buffer_returned;
+        std::condition_variable job_ready;
+    };
+#endif
+
     namespace detail {
+        // DEVIATION FROM THE LIBRARY!! LineReader's buffer, borrowed from the read service's pool
+        class pooled_buffer {
+        public:
+            pooled_buffer() = default;
+            pooled_buffer(const pooled_buffer&) = delete;
+            pooled_buffer& operator=(const pooled_buffer&) = delete;
+
+            void acquire() {
+#ifdef CSV_IO_NO_THREAD
+                buffer = std::unique_ptr<char[]>(new char[3 << 20]);
+#else
+                buffer = read_service::instance().acquire();
+#endif
+            }
+
+            char* get() const { return buffer.get(); }
+            char& operator[](int i) const { return buffer[i]; }
+
+            ~pooled_buffer() {
+#ifndef CSV_IO_NO_THREAD
+                if (buffer != nullptr)
+                    read_service::instance().release(std::move(buffer));
+#endif
+            }
+
+        private:
+            std::unique_ptr<char[]> buffer;
+        };
 
         class OwningStdIOByteSourceBase : public ByteSourceBase {
         public:
@@ -189,52 +357,169 @@ namespace io {
             long long remaining_byte_count;
         };
 
+        // DEVIATION FROM THE LIBRARY!! Decompressing byte sources, LineReader asks them for whole blocks like any other source,
+        // so after the first two blocks they run on the read-ahead thread while the previous block is parsed
+        // Each holds one compressed chunk and the decompressor's own state, however large the file is, and fills every block
+        // it is asked for since a short read is taken as the end of the input
+        inline bool ends_with(const char* str, const char* suffix) {
+            const std::size_t str_len = std::strlen(str), suffix_len = std::strlen(suffix);
+            return str_len >= suffix_len && std::strcmp(str + str_len - suffix_len, suffix) == 0;
+        }
+
+#ifdef CSV_IO_WITH_ZLIB
+        // gzip, zlib's window is 32KB, members one after another are read as one file like gunzip does
+        class OwningGzipByteSource : public ByteSourceBase {
+        public:
+            OwningGzipByteSource(FILE* file, const char* file_name) : file(file), in(new unsigned char[chunk_len]) {
+                std::setvbuf(file, 0, _IONBF, 0);
+                failed.set_file_name(file_name);
+                std::memset(&stream, 0, sizeof(stream));
+                // 15 + 32, the largest window with the gzip or zlib header detected
+                if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+                    std::fclose(file);
+                    throw failed;
+                }
+            }
+
+            int read(char* buffer, int size) {
+                stream.next_out = reinterpret_cast<Bytef*>(buffer);
+                stream.avail_out = static_cast<uInt>(size);
+                while (stream.avail_out != 0) {
+                    if (stream.avail_in == 0 && !eof) {
+                        stream.next_in = in.get();
+                        stream.avail_in = static_cast<uInt>(std::fread(in.get(), 1, chunk_len, file));
+                        eof = stream.avail_in == 0;
+                    }
+                    if (member_finished) {
+                        if (stream.avail_in == 0)
+                            break;
+                        inflateReset(&stream);
+                        member_finished = false;
+                    }
+
+                    const uInt avail_out = stream.avail_out;
+                    const int status = inflate(&stream, Z_NO_FLUSH);
+                    if (status == Z_STREAM_END)
+                        member_finished = true;
+                    else if ((status != Z_OK && status != Z_BUF_ERROR) || (eof && stream.avail_out == avail_out))
+                        throw failed;
+                }
+                return size - static_cast<int>(stream.avail_out);
+            }
+
+            ~OwningGzipByteSource() {
+                inflateEnd(&stream);
+                std::fclose(file);
+            }
+
+        private:
+            static const int chunk_len = 1 << 16;
+
+            FILE* file;
+            std::unique_ptr<unsigned char[]> in;
+            z_stream stream;
+            bool eof = false;
+            bool member_finished = false;
+            error::decompression_failed failed;
+        };
+#endif
+
+#ifdef CSV_IO_WITH_ZSTD
+        // zstd, frames one after another are read as one file, the window is what the file was compressed with, zstd
+        // refuses anything over 128MB
+        class OwningZstdByteSource : public ByteSourceBase {
+        public:
+            OwningZstdByteSource(FILE* file, const char* file_name)
+                : file(file), stream(ZSTD_createDStream()), in_len(ZSTD_DStreamInSize()), in(new char[in_len]) {
+                std::setvbuf(file, 0, _IONBF, 0);
+                failed.set_file_name(file_name);
+                if (stream == nullptr || ZSTD_isError(ZSTD_initDStream(stream))) {
+                    ZSTD_freeDStream(stream);
+                    std::fclose(file);
+                    throw failed;
+                }
+            }
+
+            int read(char* buffer, int size) {
+                ZSTD_outBuffer out = { buffer, static_cast<std::size_t>(size), 0 };
+                while (out.pos != out.size) {
+                    if (input.pos == input.size && !eof) {
+                        input = { in.get(), std::fread(in.get(), 1, in_len, file), 0 };
+                        eof = input.size == 0;
+                    }
+
+                    const std::size_t out_pos = out.pos, in_pos = input.pos;
+                    const std::size_t status = ZSTD_decompressStream(stream, &out, &input);
+                    if (ZSTD_isError(status))
+                        throw failed;
+                    if (status == 0)
+                        frame_finished = true;
+                    else if (out.pos != out_pos || input.pos != in_pos)
+                        frame_finished = false;
+
+                    // Nothing more will come, a frame left open means the file was cut short
+                    if (eof && out.pos == out_pos) {
+                        if (!frame_finished)
+                            throw failed;
+                        break;
+                    }
+                }
+                return static_cast<int>(out.pos);
+            }
+
+            ~OwningZstdByteSource() {
+                ZSTD_freeDStream(stream);
+                std::fclose(file);
+            }
+
+        private:
+            FILE* file;
+            ZSTD_DStream* stream;
+            std::size_t in_len;
+            std::unique_ptr<char[]> in;
+            ZSTD_inBuffer input = { nullptr, 0, 0 };
+            bool eof = false;
+            bool frame_finished = false;
+            error::decompression_failed failed;
+        };
+#endif
+
 #ifndef CSV_IO_NO_THREAD
+        // DEVIATION FROM THE LIBRARY!! Each read is a job on the read service's threads rather than on a thread of its own
         class AsynchronousReader {
         public:
             void init(std::unique_ptr<ByteSourceBase> arg_byte_source) {
-                std::unique_lock<std::mutex> guard(lock);
                 byte_source = std::move(arg_byte_source);
-                desired_byte_count = -1;
-                termination_requested = false;
-                worker = std::thread([&] {
+            }
+
+            bool is_valid() const { return byte_source != nullptr; }
+
+            void start_read(char* arg_buffer, int arg_desired_byte_count) {
+                {
                     std::unique_lock<std::mutex> guard(lock);
+                    read_byte_count = -1;
+                    reading = true;
+                }
+                read_service::instance().submit([this, arg_buffer, arg_desired_byte_count] {
+                    int count = -1;
+                    std::exception_ptr error;
                     try {
-                        for (;;) {
-                            read_requested_condition.wait(guard, [&] {
-                                return desired_byte_count != -1 || termination_requested;
-                                });
-                            if (termination_requested)
-                                return;
-
-                            read_byte_count = byte_source->read(buffer, desired_byte_count);
-                            desired_byte_count = -1;
-                            if (read_byte_count == 0)
-                                break;
-                            read_finished_condition.notify_one();
-                        }
+                        count = byte_source->read(arg_buffer, arg_desired_byte_count);
                     }
                     catch (...) {
-                        read_error = std::current_exception();
+                        error = std::current_exception();
                     }
+                    std::unique_lock<std::mutex> guard(lock);
+                    read_byte_count = count;
+                    read_error = error;
+                    reading = false;
                     read_finished_condition.notify_one();
                     });
             }
 
-            bool is_valid() const { return byte_source != nullptr; }
-
-            void start_read(char* arg_buffer, int arg_desired_byte_count) {
-                std::unique_lock<std::mutex> guard(lock);
-                buffer = arg_buffer;
-                desired_byte_count = arg_desired_byte_count;
-                read_byte_count = -1;
-                read_requested_condition.notify_one();
-            }
-
             int finish_read() {
                 std::unique_lock<std::mutex> guard(lock);
-                read_finished_condition.wait(
-                    guard, [&] { return read_byte_count != -1 || read_error; });
+                read_finished_condition.wait(guard, [&] { return !reading; });
                 if (read_error)
                     std::rethrow_exception(read_error);
                 else
@@ -242,30 +527,20 @@ namespace io {
             }
 
             ~AsynchronousReader() {
-                if (byte_source != nullptr) {
-                    {
-                        std::unique_lock<std::mutex> guard(lock);
-                        termination_requested = true;
-                    }
-                    read_requested_condition.notify_one();
-                    worker.join();
-                }
+                // A read still running writes into the line buffer and uses the byte source, let it finish
+                std::unique_lock<std::mutex> guard(lock);
+                read_finished_condition.wait(guard, [&] { return !reading; });
             }
 
         private:
             std::unique_ptr<ByteSourceBase> byte_source;
 
-            std::thread worker;
-
-            bool termination_requested;
+            bool reading = false;
             std::exception_ptr read_error;
-            char* buffer;
-            int desired_byte_count;
-            int read_byte_count;
+            int read_byte_count = -1;
 
             std::mutex lock;
             std::condition_variable read_finished_condition;
-            std::condition_variable read_requested_condition;
         };
 #endif
 
@@ -291,11 +566,28 @@ namespace io {
         };
     } // namespace detail
 
+    // DEVIATION FROM THE LIBRARY!! Whether LineReader(file_name) can read a file with this name, false only for .gz or .zst
+    // files this build wasn't given the library for
+    inline bool can_decompress(const char* file_name) {
+#ifndef CSV_IO_WITH_ZLIB
+        if (detail::ends_with(file_name, ".gz"))
+            return false;
+#endif
+#ifndef CSV_IO_WITH_ZSTD
+        if (detail::ends_with(file_name, ".zst"))
+            return false;
+#endif
+        return true;
+    }
+
     class LineReader {
     private:
         static const int block_len = 1 << 20;
-        std::unique_ptr<char[]> buffer; // must be constructed before (and thus
-                                        // destructed after) the reader!
+        detail::pooled_buffer buffer; // must be constructed before (and thus
+                                      // destructed after) the reader!
+#ifndef CSV_IO_NO_THREAD
+        static_assert(3 * block_len == read_service::buffer_len, "the read service pools whole line buffers");
+#endif
 #ifdef CSV_IO_NO_THREAD
         detail::SynchronousReader reader;
 #else
@@ -304,6 +596,13 @@ namespace io {
         int data_begin;
         int data_end;
 
+        // DEVIATION FROM THE LIBRARY!! Where the next '"' is, found with one memchr over everything read so far, so an
+        // unquoted file is scanned once a block, quote_end is how far that has looked, quote_pos is below data_begin when
+        // there is none before quote_end
+        int quote_pos;
+        int quote_end;
+        bool line_quoted;
+
         char file_name[error::max_file_name_length + 1];
         unsigned file_line;
 
@@ -319,14 +618,26 @@ namespace io {
                 err.set_file_name(file_name);
                 throw err;
             }
+            // DEVIATION FROM THE LIBRARY!! Compressed inputs
+#ifdef CSV_IO_WITH_ZLIB
+            if (detail::ends_with(file_name, ".gz"))
+                return std::unique_ptr<ByteSourceBase>(new detail::OwningGzipByteSource(file, file_name));
+#endif
+#ifdef CSV_IO_WITH_ZSTD
+            if (detail::ends_with(file_name, ".zst"))
+                return std::unique_ptr<ByteSourceBase>(new detail::OwningZstdByteSource(file, file_name));
+#endif
             return std::unique_ptr<ByteSourceBase>(
                 new detail::OwningStdIOByteSourceBase(file));
         }
 
         void init(std::unique_ptr<ByteSourceBase> byte_source) {
             file_line = 0;
+            quote_pos = -1;
+            quote_end = 0;
+            line_quoted = false;
 
-            buffer = std::unique_ptr<char[]>(new char[3 * block_len]);
+            buffer.acquire();
             data_begin = 0;
             data_end = byte_source->read(buffer.get(), 2 * block_len);
 
@@ -426,6 +737,9 @@ namespace io {
 
         unsigned get_file_line() const { return file_line; }
 
+        // DEVIATION FROM THE LIBRARY!! Whether the line next_line last returned has a '"' in it
+        bool line_has_quote() const { return line_quoted; }
+
         char* next_line() {
             if (data_begin == data_end)
                 return nullptr;
@@ -439,6 +753,8 @@ namespace io {
                 std::memcpy(buffer.get(), buffer.get() + block_len, block_len);
                 data_begin -= block_len;
                 data_end -= block_len;
+                quote_pos -= block_len;
+                quote_end -= block_len;
                 if (reader.is_valid()) {
                     data_end += reader.finish_read();
                     std::memcpy(buffer.get() + block_len, buffer.get() + 2 * block_len,
@@ -459,6 +775,14 @@ namespace io {
                 throw err;
             }
 
+            if (quote_pos < data_begin) {
+                const int from = (std::max)(data_begin, quote_end);
+                const void* quote = from < data_end ? std::memchr(buffer.get() + from, '"', data_end - from) : nullptr;
+                quote_pos = quote ? static_cast<int>(static_cast<const char*>(quote) - buffer.get()) : -1;
+                quote_end = quote ? quote_pos : data_end;
+            }
+            line_quoted = data_begin <= quote_pos && quote_pos < line_end;
+
             if (line_end != data_end && buffer[line_end] == '\n') {
                 buffer[line_end] = '\0';
             }
@@ -645,6 +969,55 @@ namespace io {
         };
     } // namespace error
 
+    // DEVIATION FROM THE LIBRARY!! An error code mode for rows that don't split into the expected columns,
+    // the row is skipped and recorded here instead of thrown, so one bad row doesn't cost the whole file
+    enum class parse_error {
+        none,
+        too_few_columns,
+        too_many_columns,
+        escaped_string_not_closed,
+    };
+
+    inline const char* to_string(parse_error reason) {
+        switch (reason) {
+        case parse_error::too_few_columns:
+            return "too few columns";
+        case parse_error::too_many_columns:
+            return "too many columns";
+        case parse_error::escaped_string_not_closed:
+            return "escaped string was not closed";
+        default:
+            return "";
+        }
+    }
+
+    struct parse_diagnostic {
+        unsigned file_line;
+        unsigned column; // 1 based, the column the row went wrong at
+        parse_error reason;
+    };
+
+    // Keeps the first capacity diagnostics and only counts the rest, a file that is bad on every line can't grow it
+    class parse_diagnostics {
+    public:
+        explicit parse_diagnostics(std::size_t capacity = 16) : capacity(capacity) {}
+
+        void add(unsigned file_line, unsigned column, parse_error reason) {
+            ++total;
+            if (entries.size() < capacity)
+                entries.push_back({ file_line, column, reason });
+        }
+
+        const std::vector<parse_diagnostic>& recorded() const { return entries; }
+        std::size_t count() const { return total; }
+        std::size_t dropped() const { return total - entries.size(); }
+
+    private:
+        std::size_t capacity;
+        std::size_t total{ 0 };
+        std::vector<parse_diagnostic> entries;
+    };
+
     using ignore_column = unsigned int;
     static const ignore_column ignore_no_column = 0;
     static const ignore_column ignore_extra_column = 1;
@@ -721,11 +1094,23 @@ namespace io {
             return col_begin;
         }
 
+        static const char* try_find_next_column_end(const char* col_begin) {
+            return find_next_column_end(col_begin);
+        }
+
         static void unescape(char*&, char*&) {}
     };
 
     template <char sep, char quote> struct double_quote_escape {
         static const char* find_next_column_end(const char* col_begin) {
+            const char* col_end = try_find_next_column_end(col_begin);
+            if (col_end == nullptr)
+                throw error::escaped_string_not_closed();
+            return col_end;
+        }
+
+        // nullptr when an escaped string isn't closed
+        static const char* try_find_next_column_end(const char* col_begin) {
             while (*col_begin != sep && *col_begin != '\0')
                 if (*col_begin != quote)
                     ++col_begin;
@@ -734,7 +1119,7 @@ namespace io {
                         ++col_begin;
                         while (*col_begin != quote) {
                             if (*col_begin == '\0')
-                                throw error::escaped_string_not_closed();
+                                return nullptr;
                             ++col_begin;
                         }
                         ++col_begin;
@@ -831,6 +1216,43 @@ namespace io {
                 throw ::io::error::too_many_columns();
         }
 
+        // The same without exceptions, returns why the row didn't split and the 1 based column it went wrong at
+        template <class trim_policy, class quote_policy>
+        parse_error try_parse_line(char* line, char** sorted_col,
+            const std::vector<int>& col_order, unsigned& column) {
+            column = 0;
+            for (int i : col_order) {
+                ++column;
+                if (line == nullptr)
+                    return parse_error::too_few_columns;
+
+                char* col_begin = line;
+                const char* end = quote_policy::try_find_next_column_end(col_begin);
+                if (end == nullptr)
+                    return parse_error::escaped_string_not_closed;
+                char* col_end = col_begin + (end - col_begin);
+                if (*col_end == '\0') {
+                    line = nullptr;
+                }
+                else {
+                    *col_end = '\0';
+                    line = col_end + 1;
+                }
+
+                if (i != -1) {
+                    trim_policy::trim(col_begin, col_end);
+                    quote_policy::unescape(col_begin, col_end);
+
+                    sorted_col[i] = col_begin;
+                }
+            }
+            if (line != nullptr) {
+                ++column;
+                return parse_error::too_many_columns;
+            }
+            return parse_error::none;
+        }
+
         template <unsigned column_count, class trim_policy, class quote_policy>
         void parse_header_line(char* line, std::vector<int>& col_order,
             const std::string* col_name,
@@ -899,8 +1321,78 @@ namespace io {
 
         template <class overflow_policy> void parse(char* col, char*& x) { x = col; }
 
+        // DEVIATION FROM THE LIBRARY!! Fast paths for the numeric parses, the original digit at a time loops are kept as *_loop and
+        // still handle anything the fast paths don't take, so errors and overflow_policy behave exactly as before
+
+        // Whether eight characters read little endian are all digits, and their value
+        inline bool is_eight_digits(uint64_t v) {
+            return (((v & 0xF0F0F0F0F0F0F0F0) | (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333);
+        }
+
+        inline uint32_t parse_eight_digits(uint64_t v) {
+            v -= 0x3030303030303030;
+            v = (v * 10) + (v >> 8);
+            v = (((v & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) +
+                (((v >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+            return static_cast<uint32_t>(v);
+        }
+
+        // Carry value on over len more digits, eight at a time with SWAR then one at a time, false at anything but a digit
+        inline bool accumulate_digits(const char* col, std::size_t len, uint64_t& value) {
+            if constexpr (std::endian::native == std::endian::little) {
+                for (; len >= 8; col += 8, len -= 8) {
+                    uint64_t chunk;
+                    std::memcpy(&chunk, col, 8);
+                    if (!is_eight_digits(chunk))
+                        return false;
+                    value = value * 100000000 + parse_eight_digits(chunk);
+                }
+            }
+            for (; len != 0; ++col, --len) {
+                if (*col < '0' || '9' < *col)
+                    return false;
+                value = value * 10 + static_cast<uint64_t>(*col - '0');
+            }
+            return true;
+        }
+
+        // A run of len digits that can't overflow T, false for anything else
+        template <class T>
+        bool parse_digits_fast(const char* col, std::size_t len, T& x) {
+            uint64_t value = 0;
+            if (len > static_cast<std::size_t>(std::numeric_limits<T>::digits10) || !accumulate_digits(col, len, value))
+                return false;
+            x = static_cast<T>(value);
+            return true;
+        }
+
+        // The same up to the end of the column, the first eight characters one at a time as the loop would, so short columns
+        //  cost no more than before, and only once they are all there is the rest measured and taken eight at a time
+        //  Types too narrow for eight digits are left to the loop
+        template <class T>
+        bool parse_digits_fast(const char* col, T& x) {
+            if constexpr (std::numeric_limits<T>::digits10 < 8)
+                return false;
+
+            uint64_t value = 0;
+            for (const char* first = col; col != first + 8; ++col) {
+                if (*col == '\0') {
+                    x = static_cast<T>(value);
+                    return true;
+                }
+                if (*col < '0' || '9' < *col)
+                    return false;
+                value = value * 10 + static_cast<uint64_t>(*col - '0');
+            }
+            const std::size_t len = std::strlen(col);
+            if (8 + len > static_cast<std::size_t>(std::numeric_limits<T>::digits10) || !accumulate_digits(col, len, value))
+                return false;
+            x = static_cast<T>(value);
+            return true;
+        }
+
         template <class overflow_policy, class T>
-        void parse_unsigned_integer(const char* col, T& x) {
+        void parse_unsigned_integer_loop(const char* col, T& x) {
             x = 0;
             while (*col != '\0') {
                 if ('0' <= *col && *col <= '9') {
@@ -917,6 +1409,12 @@ namespace io {
             }
         }
 
+        template <class overflow_policy, class T>
+        void parse_unsigned_integer(const char* col, T& x) {
+            if (!parse_digits_fast(col, x))
+                parse_unsigned_integer_loop<overflow_policy>(col, x);
+        }
+
         template <class overflow_policy> void parse(char* col, unsigned char& x) {
             parse_unsigned_integer<overflow_policy>(col, x);
         }
@@ -934,7 +1432,7 @@ namespace io {
         }
 
         template <class overflow_policy, class T>
-        void parse_signed_integer(const char* col, T& x) {
+        void parse_signed_integer_loop(const char* col, T& x) {
             if (*col == '-') {
                 ++col;
 
@@ -956,7 +1454,17 @@ namespace io {
             }
             else if (*col == '+')
                 ++col;
-            parse_unsigned_integer<overflow_policy>(col, x);
+            parse_unsigned_integer_loop<overflow_policy>(col, x);
+        }
+
+        template <class overflow_policy, class T>
+        void parse_signed_integer(const char* col, T& x) {
+            if (parse_digits_fast(*col == '-' || *col == '+' ? col + 1 : col, x)) {
+                if (*col == '-')
+                    x = static_cast<T>(-x);
+                return;
+            }
+            parse_signed_integer_loop<overflow_policy>(col, x);
         }
 
         template <class overflow_policy> void parse(char* col, signed char& x) {
@@ -975,7 +1483,7 @@ namespace io {
             parse_signed_integer<overflow_policy>(col, x);
         }
 
-        template <class T> void parse_float(const char* col, T& x) {
+        template <class T> void parse_float_loop(const char* col, T& x) {
             bool is_neg = false;
             if (*col == '-') {
                 is_neg = true;
@@ -1007,7 +1515,7 @@ namespace io {
                 ++col;
                 int e;
 
-                parse_signed_integer<set_to_max_on_overflow>(col, e);
+                parse_signed_integer_loop<set_to_max_on_overflow>(col, e);
 
                 if (e != 0) {
                     T base;
@@ -1041,6 +1549,82 @@ namespace io {
                 x = -x;
         }
 
+        // The largest power of ten that T holds exactly along with any mantissa of T's width
+        template <class T> constexpr int exact_power_of_ten_limit() {
+            int e = 0;
+            for (uint64_t five = 5; e < 27 && five < (uint64_t(1) << std::min(std::numeric_limits<T>::digits, 63)); five *= 5)
+                ++e;
+            return e;
+        }
+
+        // Clinger's fast path, up to 19 digits with a small enough exponent are one exact multiply or divide and so correctly
+        // rounded, takes a decimal comma like the loop, false for anything else
+        template <class T> bool parse_float_fast(const char* col, T& x) {
+            static constexpr T powers[] = { T(1e0L), T(1e1L), T(1e2L), T(1e3L), T(1e4L), T(1e5L), T(1e6L), T(1e7L), T(1e8L), T(1e9L), T(1e10L),
+                T(1e11L), T(1e12L), T(1e13L), T(1e14L), T(1e15L), T(1e16L), T(1e17L), T(1e18L), T(1e19L), T(1e20L), T(1e21L), T(1e22L),
+                T(1e23L), T(1e24L), T(1e25L), T(1e26L), T(1e27L) };
+            constexpr int limit = exact_power_of_ten_limit<T>();
+
+            const bool is_neg = *col == '-';
+            if (is_neg)
+                ++col;
+
+            uint64_t mantissa = 0;
+            int digits = 0;
+            int exponent = 0;
+            for (; '0' <= *col && *col <= '9'; ++col, ++digits)
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*col - '0');
+            if (*col == '.' || *col == ',') {
+                for (++col; '0' <= *col && *col <= '9'; ++col, ++digits, --exponent)
+                    mantissa = mantissa * 10 + static_cast<uint64_t>(*col - '0');
+            }
+            if (digits == 0 || digits > 19)
+                return false;
+
+            if (*col == 'e' || *col == 'E') {
+                ++col;
+                const bool is_neg_exponent = *col == '-';
+                if (*col == '-' || *col == '+')
+                    ++col;
+                int e = 0;
+                int exponent_digits = 0;
+                for (; '0' <= *col && *col <= '9' && exponent_digits != 4; ++col, ++exponent_digits)
+                    e = e * 10 + (*col - '0');
+                if (exponent_digits == 0)
+                    return false;
+                exponent += is_neg_exponent ? -e : e;
+            }
+            if (*col != '\0')
+                return false;
+
+            if (mantissa > (uint64_t(1) << std::min(std::numeric_limits<T>::digits, 63)) || exponent < -limit || limit < exponent)
+                return false;
+            x = static_cast<T>(mantissa);
+            if (exponent < 0)
+                x /= powers[-exponent];
+            else
+                x *= powers[exponent];
+            if (is_neg)
+                x = -x;
+            return true;
+        }
+
+        // The fast path, then std::from_chars, correctly rounded, for everything else it reads the same way as the loop,
+        // which still takes a long decimal comma, a leading '+', an empty column and exponents out of range
+        template <class T> void parse_float(const char* col, T& x) {
+            if (parse_float_fast(col, x))
+                return;
+
+            const char* digits = *col == '-' ? col + 1 : col;
+            if (('0' <= *digits && *digits <= '9') || *digits == '.') {
+                const char* end = col + std::strlen(col);
+                const auto [last, ec] = std::from_chars(col, end, x);
+                if (ec == std::errc() && last == end)
+                    return;
+            }
+            parse_float_loop(col, x);
+        }
+
         template <class overflow_policy> void parse(char* col, float& x) {
             parse_float(col, x);
         }
@@ -1065,6 +1649,116 @@ namespace io {
 
     } // namespace detail
 
+    // DEVIATION FROM THE LIBRARY!! schema_reader's names as they are in the line
+    struct verbatim_names {
+        static const char* clean(char* begin, char*, std::string&) { return begin; }
+    };
+
+    // DEVIATION FROM THE LIBRARY!! A reader for one fixed layout: name_columns text columns, one whole number column, and any
+    // number of status columns from a closed set of strings, each turned into a uint8 code while the line is split
+    // status_codec::match(begin, sep, code) recognises a status the way it is always written and returns where the cell ends,
+    // so the split jumps over it, or nullptr to fall back to finding the separator, trimming and status_codec::decode(begin, end)
+    // Lines are split on sep alone unless the caller says they have a quote in them (LineReader::line_has_quote), only those
+    // go through quote_policy to find the end of each cell and unescape it
+    // Each trimmed name goes through name_codec::clean(begin, end, scratch), which returns begin or a cleaned copy in scratch
+    template <unsigned name_columns, class status_codec, class name_codec = verbatim_names, class trim_policy = trim_chars<' ', '\t'>,
+        char sep = ',', class quote_policy = double_quote_escape<sep, '"'>>
+    class schema_reader {
+    public:
+        // col_order maps each column in the file to where it goes: 0 to name_columns - 1 are the names, number_column is the
+        // number, the rest from name_columns on are statuses, and -1 skips the column
+        schema_reader(std::vector<int> col_order, unsigned status_columns, int number_column)
+            : col_order(std::move(col_order)), number_column(number_column), codes(status_columns) {
+            empty_code = status_codec::decode(empty, empty);
+        }
+
+        // Split one line in place, with try_parse_line's errors, names point into the line until the next one
+        // A column missing from the file reads as an empty cell
+        parse_error parse(char* line, unsigned& column, bool quoted = false) {
+            if (quoted) [[unlikely]]
+                return split<true>(line, column);
+            return split<false>(line, column);
+        }
+
+        const char* name(unsigned i) const { return names[i]; }
+
+        // -1 when the cell isn't a whole number
+        int number() const { return value; }
+
+        const std::vector<uint8_t>& status_codes() const { return codes; }
+
+    private:
+        template <bool quoted>
+        parse_error split(char* line, unsigned& column) {
+            std::fill(std::begin(names), std::end(names), empty);
+            std::fill(codes.begin(), codes.end(), empty_code);
+            value = -1;
+
+            column = 0;
+            for (int i : col_order) {
+                ++column;
+                if (line == nullptr)
+                    return parse_error::too_few_columns;
+
+                char* col_begin = line;
+                if (i >= static_cast<int>(name_columns) && i != number_column) {
+                    uint8_t code;
+                    if (const char* end = status_codec::match(col_begin, sep, code)) {
+                        codes[i - name_columns] = code;
+                        line = *end == '\0' ? nullptr : col_begin + (end - col_begin) + 1;
+                        continue;
+                    }
+                }
+
+                char* col_end = line;
+                if constexpr (quoted) {
+                    const char* end = quote_policy::try_find_next_column_end(col_begin);
+                    if (end == nullptr)
+                        return parse_error::escaped_string_not_closed;
+                    col_end += end - col_begin;
+                }
+                else {
+                    while (*col_end != sep && *col_end != '\0')
+                        ++col_end;
+                }
+                line = *col_end == '\0' ? nullptr : col_end + 1;
+                if (i < 0) {
+                    continue;
+                }
+
+                trim_policy::trim(col_begin, col_end);
+                if constexpr (quoted)
+                    quote_policy::unescape(col_begin, col_end);
+                if (i < static_cast<int>(name_columns))
+                    names[i] = name_codec::clean(col_begin, col_end, cleaned[i]);
+                else if (i == number_column)
+                    value = parse_number(col_begin, col_end);
+                else
+                    codes[i - name_columns] = status_codec::decode(col_begin, col_end);
+            }
+            if (line != nullptr) {
+                ++column;
+                return parse_error::too_many_columns;
+            }
+            return parse_error::none;
+        }
+
+        static int parse_number(const char* begin, const char* end) {
+            int number;
+            return begin != end && detail::parse_digits_fast(begin, static_cast<std::size_t>(end - begin), number) ? number : -1;
+        }
+
+        static inline char empty[] = "";
+
+        std::vector<int> col_order;
+        int number_column;
+        const char* names[name_columns];
+        std::string cleaned[name_columns];
+        int value = -1;
+        std::vector<uint8_t> codes;
+        uint8_t empty_code;
+    };
+
     template <unsigned column_count, class trim_policy = trim_chars<' ', '\t'>,
         class quote_policy = no_quote_escape<','>,
         class overflow_policy = throw_on_overflow,
@@ -1217,6 +1911,46 @@ namespace io {
 
                 return true;
             }
+
+            // DEVIATION FROM THE LIBRARY!! read_row that skips rows with the wrong column count or an unclosed escaped string,
+            // recording them in diagnostics instead of throwing, a bad value in a typed column still throws like read_row
+            template <class... ColType> bool try_read_row(parse_diagnostics& diagnostics, ColType &... cols) {
+                static_assert(sizeof...(ColType) >= column_count,
+                    "not enough columns specified");
+                static_assert(sizeof...(ColType) <= column_count,
+                    "too many columns specified");
+                for (;;) {
+                    char* line = in.next_line();
+                    if (!line)
+                        return false;
+                    if (comment_policy::is_comment(line))
+                        continue;
+
+                    unsigned column;
+                    const parse_error reason = detail::try_parse_line<trim_policy, quote_policy>(line, row, col_order, column);
+                    if (reason != parse_error::none) {
+                        diagnostics.add(in.get_file_line(), column, reason);
+                        continue;
+                    }
+                    break;
+                }
+
+                try {
+                    try {
+                        parse_helper(0, cols...);
+                    }
+                    catch (error::with_file_name& err) {
+                        err.set_file_name(in.get_truncated_file_name());
+                        throw;
+                    }
+                }
+                catch (error::with_file_line& err) {
+                    err.set_file_line(in.get_file_line());
+                    throw;
+                }
+
+                return true;
+            }
     };
 } // namespace io
 #endif
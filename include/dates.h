@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+
+// Calendar math on day numbers (days since 1970-01-01, proleptic Gregorian)
+//  No time zones and no mktime/localtime, so these are safe to call from any thread
+
+// Days since 1970-01-01 for a civil date (Howard Hinnant's days_from_civil)
+constexpr int64_t DaysFromCivil(int64_t y, unsigned m, unsigned d)
+{
+	y -= m <= 2;
+	const int64_t era = (y >= 0 ? y : y - 399) / 400;
+	const unsigned yoe = static_cast<unsigned>(y - era * 400);
+	const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+// The civil date for a day number (Howard Hinnant's civil_from_days)
+constexpr void CivilFromDays(int64_t z, int& y, unsigned& m, unsigned& d)
+{
+	z += 719468;
+	const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+	const unsigned doe = static_cast<unsigned>(z - era * 146097);
+	const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	const unsigned mp = (5 * doy + 2) / 153;
+	d = doy - (153 * mp + 2) / 5 + 1;
+	m = mp < 10 ? mp + 3 : mp - 9;
+	y = static_cast<int>(yoe + era * 400 + (m <= 2));
+}
+
+// 0 = Sunday ... 6 = Saturday, 1970-01-01 was a Thursday
+constexpr unsigned WeekdayFromDays(int64_t z)
+{
+	return static_cast<unsigned>(z >= -4 ? (z + 4) % 7 : (z + 5) % 7 + 6);
+}
+
+constexpr bool IsLeapYear(int64_t y)
+{
+	return y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+}
+
+constexpr unsigned DaysInMonth(int64_t y, unsigned m)
+{
+	constexpr unsigned days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	return m == 2 && IsLeapYear(y) ? 29 : days[m - 1];
+}
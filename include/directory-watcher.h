@@ -0,0 +1,54 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Watches one directory (not its subdirectories) for .csv files that have been created, replaced or rewritten
+//  inotify on Linux, a directory scan every poll elsewhere or when inotify can't be used
+//  A file is only handed out once it has gone quiet for the settle time, so half-copied exports are left alone
+class DirectoryWatcher
+{
+public:
+	DirectoryWatcher(const std::string& directory, std::chrono::milliseconds settle);
+	~DirectoryWatcher();
+
+	DirectoryWatcher(const DirectoryWatcher&) = delete;
+	DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+	// Start watching, files already in the directory count as new, returns false with a reason when the directory can't be read
+	bool Open(std::string& reason);
+
+	bool UsingInotify() const { return inotifyFd >= 0; }
+
+	// Wait up to timeout for changes, then append the path of every file that has settled
+	void Poll(std::chrono::milliseconds timeout, std::vector<std::string>& ready);
+
+private:
+	// What a file looked like the last time we checked
+	struct FileState
+	{
+		std::uintmax_t size{ 0 };
+		std::filesystem::file_time_type modified{};
+
+		bool operator==(const FileState&) const = default;
+	};
+
+	struct Pending
+	{
+		FileState state{};
+		std::chrono::steady_clock::time_point last_change{};
+	};
+
+	void Scan();
+	void Touch(const std::filesystem::path& path);
+	void ReadEvents(std::chrono::milliseconds timeout);
+
+	std::filesystem::path directory;
+	std::chrono::milliseconds settle;
+	std::unordered_map<std::string, Pending> pending;
+	std::unordered_map<std::string, FileState> handedOut;
+	int inotifyFd{ -1 };
+};
@@ -0,0 +1,256 @@
+#pragma once
+#include "attendance-history.h"
+#include "outreach-rules.h"
+#include "person.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class SundayTable;
+class MemberIndex;
+
+// libeya-attendance, the attendance pipeline as a library
+//  Nothing in here prints, waits on the console or writes files on its own, messages come back as diagnostics
+//  Separate analyses can run on separate threads, every one shares the process's read-ahead threads and buffer pool
+//  (SetReadLimits) and the scheduler its stages split their work across (SetWorkerThreads), beyond that an AnalysisCache
+//  is shared only by the calls it's passed to
+//  Call SetWorkerThreads, and SetReadLimits for the thread count, before the first analysis, afterwards they're fixed
+
+namespace eya
+{
+	// Bumped whenever a structure or signature below changes in a way callers would notice
+	constexpr int api_version = 6;
+
+	enum class Status
+	{
+		OK,
+		INVALID_INPUT,  // missing file or not a .csv
+		NO_HEADER_ROW,  // couldn't read the first row
+		BAD_HEADER_ROW, // the first row isn't a Planning Center attendance header
+		PARSE_FAILED,   // the csv parser threw while building the roll
+		COUNT_FAILED,
+	};
+
+	struct Diagnostic
+	{
+		enum class Severity
+		{
+			INFO,
+			WARNING,
+			ERROR,
+		};
+		Severity severity{ Severity::INFO };
+		std::string message{};
+	};
+	using Diagnostics = std::vector<Diagnostic>;
+
+	// Someone on the outreach list, member indexes into AnalysisResult::roll
+	struct OutreachEntry
+	{
+		uint32_t member{ 0 };
+		OutreachAction action{ OutreachAction::NONE };
+		int32_t weeks_absent{ 0 };
+	};
+
+	// Headcounts for one Sunday column, visits count as visitors and the rest by what each cell says they attended as that
+	//  Sunday, so someone who became a leader is still a member on the Sundays before
+	struct SundayCounts
+	{
+		uint32_t members{ 0 };
+		uint32_t leaders{ 0 };
+		uint32_t visitors{ 0 };
+		uint32_t absent{ 0 };    // on the roll with attendance taken, and not there
+		uint32_t not_taken{ 0 };
+		uint32_t off_roll{ 0 };  // membership removed
+		double average_4{ 0 };   // headcount over the last 4 Sundays attendance was taken, this one included
+		double average_12{ 0 };
+
+		uint32_t Headcount() const { return members + leaders + visitors; }
+	};
+
+	// One member's attendance rate over the Sundays they were on the roll and attendance was taken
+	struct MemberRate
+	{
+		uint32_t attended{ 0 };
+		uint32_t possible{ 0 };
+		int32_t percent{ -1 };   // rounded like the export's percent column, -1 when possible is 0
+	};
+
+	struct Analytics
+	{
+		std::vector<SundayCounts> sundays; // one per Sunday column
+		std::vector<MemberRate> rates;     // one per roll member
+		uint32_t percent_mismatches{ 0 };  // members whose rate is more than a point away from the export's percent
+	};
+
+	// Everyone grouped by the month they were first seen, and how many of each group attended in each month after
+	//  Whoever was already coming when the export starts lands in the first month's cohort
+	struct Cohorts
+	{
+		std::vector<std::string> months; // "yyyy-mm" for every month the export covers, cohort i is everyone first seen in months[i]
+		std::vector<uint32_t> sizes;     // members in each cohort
+		std::vector<uint32_t> retained;  // months x months, [cohort * months.size() + offset] attended at least once in month cohort + offset
+
+		// The fraction of a cohort that attended offset months after it started, 0 for an empty cohort or past the end of the export
+		double Retention(std::size_t cohort, std::size_t offset) const
+		{
+			if (cohort >= sizes.size() || sizes[cohort] == 0 || cohort + offset >= months.size())
+				return 0;
+			return static_cast<double>(retained[cohort * months.size() + offset]) / sizes[cohort];
+		}
+	};
+
+	// How much of the pipeline to run
+	//  OUTREACH_ONLY keeps just what the outreach file needs, each member's attendance_list holds only the last Sunday
+	//  and analytics and cohorts are left empty, so WriteOutreach is the only writer that will run
+	//  COMPRESSED writes everything FULL does, but every Sunday is kept in AnalysisResult::history at a few bits a cell and
+	//  attendance_list holds only the last Sunday, for exports too long to hold any other way, a query server needs FULL
+	enum class Pipeline
+	{
+		FULL,
+		OUTREACH_ONLY,
+		COMPRESSED,
+	};
+
+	struct AnalysisResult
+	{
+		Pipeline pipeline{ Pipeline::FULL };
+		std::string date{};                  // yyyy-mm-dd from the export's name, empty when the name doesn't follow the convention
+		std::vector<std::string> headers;    // "first name", "last name", then one per Sunday
+		std::vector<person> roll;            // with weeks_absent filled in for every Sunday
+		std::vector<OutreachAction> actions; // one per roll member, shared by the report and outreach writers
+		std::vector<OutreachEntry> outreach; // everyone with an action this week, in roll order
+		Analytics analytics;
+		Cohorts cohorts;
+		AttendanceHistory history;           // every member's statuses for every Sunday under COMPRESSED, empty otherwise
+	};
+
+	// Someone in an at-risk ranking, member indexes into AnalysisResult::roll
+	struct AtRiskEntry
+	{
+		uint32_t member{ 0 };
+		float score{ 0 };            // 0-1, higher is more at risk
+		int32_t weeks_absent{ 0 };
+		int32_t weeks_since_seen{ 0 }; // since they were first seen present or visiting
+	};
+	using AtRiskRanking = std::vector<AtRiskEntry>;
+
+	// One person from a run's outreach state, the compact record the next run's delta is worked out against
+	struct OutreachStateEntry
+	{
+		std::string first_name{};
+		std::string last_name{};
+		uint32_t occurrence{ 1 }; // which of the people on the roll with this name, 1 for the first
+		OutreachAction action{ OutreachAction::NONE };
+		int32_t weeks_absent{ 0 };
+	};
+	using OutreachState = std::vector<OutreachStateEntry>;
+
+	// Someone whose outreach changed since the previous run
+	//  NEW wasn't on the previous list, or starts again lower after coming back, ESCALATED moved up a step or more,
+	//  RESOLVED was on the previous list and isn't now, whether they came back, were given up on or left the roll
+	struct OutreachChange
+	{
+		enum class Kind
+		{
+			NEW,
+			ESCALATED,
+			RESOLVED,
+		};
+		Kind kind{ Kind::NEW };
+		std::string first_name{};
+		std::string last_name{};
+		person::MemberType member_type{ person::MemberType::NA }; // NA when they have left the roll
+		OutreachAction previous{ OutreachAction::NONE };
+		OutreachAction action{ OutreachAction::NONE };
+		int32_t weeks_absent{ 99 };
+	};
+	using OutreachDelta = std::vector<OutreachChange>;
+
+	// Warm state for processes that analyze many exports, share one between threads and pass it to every call
+	//  Holds the header dates already checked and the index of every member seen so far
+	class AnalysisCache
+	{
+	public:
+		AnalysisCache();
+		~AnalysisCache();
+
+		AnalysisCache(const AnalysisCache&) = delete;
+		AnalysisCache& operator=(const AnalysisCache&) = delete;
+
+		SundayTable& Sundays() { return *sundays; }
+		MemberIndex& Members() { return *members; }
+
+	private:
+		std::unique_ptr<SundayTable> sundays;
+		std::unique_ptr<MemberIndex> members;
+	};
+
+	// Size the reading shared by every analysis in the process, a fixed set of read-ahead threads and a pool of 3MB line
+	//  buffers capped at maxBufferedBytes, analyses past the cap wait for one to finish reading
+	//  threads only counts before the first analysis, 0 leaves either as it is (2 threads, 64MB)
+	void SetReadLimits(unsigned threads, std::size_t maxBufferedBytes);
+
+	// Size the scheduler every stage splits its work across, workers 0 for one per hardware thread, pinThreads to keep
+	//  each worker on a CPU of its own
+	//  Only counts before the first analysis, returns false when the scheduler has already started
+	bool SetWorkerThreads(unsigned workers, bool pinThreads);
+
+	// FULL, or COMPRESSED for an export too long to hold every cell uncompressed, going by its size on disk with .gz and .zst
+	//  exports taken at 10 times theirs
+	Pipeline PipelineForExport(const std::string& filePath);
+
+	// Run the whole pipeline on an export on disk
+	//  Outreach follows rules when given, the long-standing ladder otherwise
+	Status AnalyzeFile(const std::string& filePath, AnalysisResult& result, Diagnostics& diagnostics, AnalysisCache* cache = nullptr, const OutreachRules* rules = nullptr,
+		Pipeline pipeline = Pipeline::FULL);
+
+	// Run the pipeline on an export already in memory, the buffer isn't copied and must outlive the call
+	//  name is only used for the date and in diagnostics, it doesn't have to exist on disk
+	Status AnalyzeBuffer(const char* data, std::size_t size, const std::string& name, AnalysisResult& result, Diagnostics& diagnostics, AnalysisCache* cache = nullptr,
+		const OutreachRules* rules = nullptr, Pipeline pipeline = Pipeline::FULL);
+
+	// Run the pipeline on an open file descriptor (file, pipe or socket), read to the end but not closed
+	Status AnalyzeFd(int fd, const std::string& name, AnalysisResult& result, Diagnostics& diagnostics, AnalysisCache* cache = nullptr, const OutreachRules* rules = nullptr,
+		Pipeline pipeline = Pipeline::FULL);
+
+	// The k members most at risk, highest score first, scored on current streak, attendance rate, how recently they
+	//  started coming and member type, only people who missed the last Sunday but haven't been gone half a year are ranked
+	bool RankAtRisk(const AnalysisResult& result, std::size_t k, AtRiskRanking& ranking);
+
+	// The same for several groups' analyses at once, one ranking per group, groups are ranked in parallel
+	bool RankAtRisk(const std::vector<const AnalysisResult*>& groups, std::size_t k, std::vector<AtRiskRanking>& rankings);
+
+	// Read back an outreach state file, returns false with the line at fault
+	bool ReadOutreachState(std::istream& in, OutreachState& state, std::string& error);
+
+	// What changed since the previous run's state, a hash join on name and occurrence so it stays linear in the roll
+	//  Changes come in roll order, then anyone resolved by leaving the roll in the previous state's order
+	bool DiffOutreach(const OutreachState& previous, const AnalysisResult& result, OutreachDelta& delta);
+
+	// The report, outreach, analytics and cohort csv files, written to any stream
+	bool WriteReport(std::ostream& out, const AnalysisResult& result);
+	bool WriteOutreach(std::ostream& out, const AnalysisResult& result);
+	bool WriteAnalytics(std::ostream& out, const AnalysisResult& result);
+	bool WriteCohorts(std::ostream& out, const AnalysisResult& result);
+	bool WriteAtRisk(std::ostream& out, const AnalysisResult& result, const AtRiskRanking& ranking);
+	bool WriteOutreachState(std::ostream& out, const AnalysisResult& result);
+	bool WriteOutreachDelta(std::ostream& out, const OutreachDelta& delta);
+
+	// The names the executable gives the outputs, "report-yyyy-mm-dd.csv" or "report.csv" without a date
+	std::string ReportFileName(const AnalysisResult& result);
+	std::string OutreachFileName(const AnalysisResult& result);
+	std::string AnalyticsFileName(const AnalysisResult& result);
+	std::string CohortFileName(const AnalysisResult& result);
+	std::string AtRiskFileName(const AnalysisResult& result);
+	std::string OutreachStateFileName(const AnalysisResult& result);
+	std::string OutreachDeltaFileName(const AnalysisResult& result);
+
+	const char* ToString(Status status);
+	const char* ToString(person::MemberType memberType);
+	const char* ToString(OutreachAction action);
+	const char* ToString(OutreachChange::Kind kind);
+}
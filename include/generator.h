@@ -0,0 +1,76 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+// A coroutine that hands out values one at a time, the coroutine co_yields them and the caller takes them with a range-for
+//  The coroutine runs only while the loop asks for the next value, and a value lives in the coroutine, valid until then
+//  An exception the coroutine doesn't catch comes out of the loop
+template <typename T>
+class Generator
+{
+public:
+	struct promise_type
+	{
+		const T* value{ nullptr };
+		std::exception_ptr error{};
+
+		Generator get_return_object() { return Generator{ std::coroutine_handle<promise_type>::from_promise(*this) }; }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		std::suspend_always yield_value(const T& yielded) noexcept
+		{
+			value = &yielded;
+			return {};
+		}
+		void return_void() {}
+		void unhandled_exception() { error = std::current_exception(); }
+	};
+
+	struct End {};
+
+	class Iterator
+	{
+	public:
+		explicit Iterator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+		const T& operator*() const { return *handle.promise().value; }
+		Iterator& operator++()
+		{
+			Resume(handle);
+			return *this;
+		}
+		bool operator==(End) const { return handle.done(); }
+
+	private:
+		std::coroutine_handle<promise_type> handle;
+	};
+
+	explicit Generator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+	Generator(Generator&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+	Generator(const Generator&) = delete;
+	Generator& operator=(const Generator&) = delete;
+	~Generator()
+	{
+		if (handle)
+			handle.destroy();
+	}
+
+	// Runs the coroutine up to its first value, so only call once
+	Iterator begin()
+	{
+		Resume(handle);
+		return Iterator{ handle };
+	}
+	End end() const { return {}; }
+
+private:
+	static void Resume(std::coroutine_handle<promise_type> handle)
+	{
+		handle.resume();
+		if (handle.promise().error)
+			std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+	}
+
+	std::coroutine_handle<promise_type> handle;
+};
@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+
+// Turns a name cell into what goes on the roll, io::schema_reader runs every name column through this as it splits a row
+//  Plain ASCII names, nearly all of them, pass straight through after one vector pass over their bytes
+//  Anything else is rebuilt: malformed UTF-8 becomes U+FFFD, a letter followed by a combining accent becomes the precomposed
+//  letter (NFC over Latin-1 and Latin Extended-A/B) and no-break spaces are trimmed from the ends
+struct NameCodec
+{
+	// begin and end are already trimmed of spaces and tabs, returns begin or repaired's buffer
+	static const char* clean(char* begin, char* end, std::string& repaired);
+};
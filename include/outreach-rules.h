@@ -0,0 +1,52 @@
+#pragma once
+#include "person.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+
+namespace eya
+{
+	enum class OutreachAction
+	{
+		NONE,
+		TEXT,
+		POST_CARD,
+		PHONE_CALL,
+		VISIT,
+	};
+
+	// Which action someone gets for their current streak, by member type, and when to stop reaching out to them
+	//  Rules are compiled into a flat table once, evaluating a whole roll is then a lookup per member with no branches
+	//  Text form, one rule per line, # starts a comment
+	//    <member type> <weeks absent> <action>
+	//  member type is member, leader, visitor, na or * for all four
+	//  action is text, post-card, phone-call, visit, none, or give-up, once someone who has been seen reaches
+	//  give-up weeks absent they never get another action, and weeks past the last rule get none
+	class OutreachRules
+	{
+	public:
+		// Longest streak a rule can name, 99 and up means off the roll
+		static constexpr int32_t max_weeks = 98;
+
+		// The ladder the program has always used, 2 Text, 3 Post Card, 4 Phone Call, 5 Visit, give up at 6
+		OutreachRules();
+
+		// Replace the rules with the ones in a rules file, returns false with the line at fault and leaves the rules alone
+		bool Load(std::istream& in, std::string& error);
+		bool LoadFile(const std::string& path, std::string& error);
+
+		// Evaluate count members at once from columns of member type, current weeks absent and longest streak so far
+		void Evaluate(const uint8_t* memberTypes, const int32_t* weeksAbsent, const int32_t* longestStreaks, std::size_t count, OutreachAction* actions) const;
+
+		OutreachAction Action(person::MemberType memberType, int32_t weeksAbsent, int32_t longestStreak) const;
+
+	private:
+		// Past max_weeks, a column that is always NONE so out of range streaks need no check of their own
+		static constexpr std::size_t stride = 128;
+
+		std::array<uint8_t, 4 * stride> table{};
+		std::array<int32_t, 4> giveUp{};
+	};
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Linux perf_event hardware counters for a measured region (--perf)
+//  On other platforms, or when perf_event_paranoid / a VM blocks access, the group opens as unavailable
+
+struct PerfCounterValues
+{
+	enum Counter
+	{
+		CYCLES,
+		INSTRUCTIONS,
+		BRANCH_MISSES,
+		CACHE_MISSES,
+		COUNT,
+	};
+
+	bool valid{ false };
+	bool available[COUNT]{};
+	uint64_t values[COUNT]{};
+
+	bool Has(Counter c) const { return valid && available[c]; }
+};
+
+// One counter group (cycles as the leader) that can be started and stopped around a region
+class PerfCounterGroup
+{
+public:
+	PerfCounterGroup();
+	~PerfCounterGroup();
+
+	PerfCounterGroup(const PerfCounterGroup&) = delete;
+	PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+	bool IsAvailable() const { return leader_fd != -1; }
+	const std::string& Error() const { return error; }
+
+	void Start();
+	PerfCounterValues Stop();
+
+private:
+	int leader_fd{ -1 };
+	int fds[PerfCounterValues::COUNT]{ -1, -1, -1, -1 };
+	uint64_t ids[PerfCounterValues::COUNT]{};
+	std::string error{};
+};
+
+// Probe once whether counters can be opened, reason explains why not (e.g. the perf_event_paranoid level)
+bool PerfCountersSupported(std::string& reason);
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -7,9 +8,10 @@ class person
 public:
 	std::string first_name{};
 	std::string last_name{};
+	int32_t percent{ -1 }; // the export's own attendance percentage, -1 when the cell isn't a number
 	bool seen{ false };
-	bool been_through_process{ false };
-	enum class MemberType
+	int32_t longest_streak{ 0 }; // most weeks absent in a row since they were seen, outreach gives up once it gets too long
+	enum class MemberType : uint8_t
 	{
 		NA,
 		MEMBER,
@@ -18,7 +20,7 @@ public:
 	};
 	MemberType member_type{ MemberType::NA };
 
-	enum class AttendanceType
+	enum class AttendanceType : uint8_t
 	{
 		NA,
 		NOT_TAKEN,
@@ -30,6 +32,7 @@ public:
 	{
 		std::string date{};
 		AttendanceType type{ AttendanceType::NA };
+		MemberType attended_as{ MemberType::NA }; // what the cell says they attended as that Sunday, NA when it doesn't say
 		int32_t weeks_absent{ 99 };
 	};
 	std::vector<Attendance> attendance_list;
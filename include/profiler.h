@@ -0,0 +1,86 @@
+#pragma once
+#include "perf-counters.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+
+// Built-in profiling for the pipeline stages (--profile / --trace)
+//  When profiling is off every hook below is a single relaxed load and a branch
+
+namespace profiler_detail
+{
+	extern std::atomic<bool> enabled;
+}
+
+// Everything recorded for a single stage, offsets and durations are relative to EnableProfiling()
+struct ProfileStats
+{
+	std::string name{};
+	uint32_t depth{ 0 };
+	double start_us{ 0 };
+	double wall_ms{ 0 };
+	double cpu_ms{ 0 };
+	uint64_t bytes_read{ 0 };
+	uint64_t bytes_written{ 0 };
+	uint64_t rows{ 0 };
+	uint64_t cells{ 0 };
+	uint64_t allocations{ 0 };
+	uint64_t allocated_bytes{ 0 };
+	PerfCounterValues counters{};
+};
+
+// Turn on stage recording and the allocation counters in the operator new hook
+void EnableProfiling();
+
+inline bool ProfilingEnabled()
+{
+	return profiler_detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Also open a perf_event counter group around every stage (--perf), returns false with a reason when blocked
+bool EnableHardwareCounters(std::string& reason);
+
+// Called by the replaceable operator new, only counts while profiling is enabled
+void ProfileRecordAllocation(std::size_t size);
+
+// Attribute work to the innermost stage that is open on the calling thread
+void ProfileAddBytesRead(uint64_t bytes);
+void ProfileAddBytesWritten(uint64_t bytes);
+void ProfileAddRows(uint64_t rows);
+void ProfileAddCells(uint64_t cells);
+
+// RAII scope around a pipeline stage, e.g. { ProfileStage stage{ "CountAbsentWeeks" }; ... }
+class ProfileStage
+{
+public:
+	explicit ProfileStage(const char* name);
+	~ProfileStage();
+
+	ProfileStage(const ProfileStage&) = delete;
+	ProfileStage& operator=(const ProfileStage&) = delete;
+
+private:
+	friend void ProfileAddBytesRead(uint64_t);
+	friend void ProfileAddBytesWritten(uint64_t);
+	friend void ProfileAddRows(uint64_t);
+	friend void ProfileAddCells(uint64_t);
+
+	bool active{ false };
+	ProfileStage* parent{ nullptr };
+	std::size_t index{ 0 };
+	std::chrono::steady_clock::time_point wall_start{};
+	double cpu_start_ms{ 0 };
+	uint64_t allocations_start{ 0 };
+	uint64_t allocated_bytes_start{ 0 };
+	ProfileStats stats{};
+	std::unique_ptr<PerfCounterGroup> counters{};
+};
+
+// Print a table of every recorded stage, plus IPC and misses per row/cell when hardware counters are on
+void PrintProfileSummary(std::ostream& out);
+
+// Write the recorded stages as a Chrome trace-event JSON file (load in chrome://tracing or Perfetto)
+bool WriteProfileTrace(const std::string& filePath);
@@ -0,0 +1,53 @@
+#pragma once
+#include "roll-index.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+// --serve, answers questions about the latest roll over HTTP on localhost or a Unix socket
+//  GET /status                          the loaded export
+//  GET /streak?weeks=3                  everyone currently at 0-5, 6+ or na weeks absent
+//  GET /streak?weeks=3&date=2024-01-14  the same as of the last Sunday on or before a date
+//  GET /crossed?weeks=3&from=2024-01-01&to=2024-03-31
+//                                       everyone whose streak reached 3 weeks on a Sunday after from, up to to
+//  GET /person?name=First%20Last        someone's whole history, ignoring case
+//  GET /members?type=visitor&month=2024-01
+//                                       everyone whose member type is member, leader, visitor or na,
+//                                       optionally only those who attended in that month
+//  GET /outreach                        this week's outreach list
+// Responses are JSON, one request per connection
+
+class QueryServer
+{
+public:
+	QueryServer() = default;
+	~QueryServer();
+
+	QueryServer(const QueryServer&) = delete;
+	QueryServer& operator=(const QueryServer&) = delete;
+
+	// Listen on "port" (127.0.0.1 only) or "unix:/path/to/socket", returns false with a reason on failure
+	bool Open(const std::string& address, std::string& reason);
+
+	// Answer requests on a background thread until Stop()
+	void Start();
+	void Stop();
+
+	// Swap in a new index, requests already being answered finish on the one they started with
+	void Publish(std::shared_ptr<const RollIndex> index);
+
+	// Route one request target (path and query string) to its JSON answer, returns the HTTP status code
+	int Answer(const std::string& target, std::string& body) const;
+
+private:
+	void Run();
+	void HandleConnection(std::intptr_t client);
+
+	std::atomic<std::shared_ptr<const RollIndex>> current{};
+	std::intptr_t listener{ -1 };
+	std::string unixPath{};
+	std::atomic<bool> stopping{ false };
+	std::thread thread{};
+};
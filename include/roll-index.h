@@ -0,0 +1,58 @@
+#pragma once
+#include "eya-attendance.h"
+#include "streak-index.h"
+#include <array>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Read-only lookups over one analysis, built once per export for the query server
+//  Never changed after construction, a new export gets a new index that replaces the old shared_ptr
+
+class RollIndex
+{
+public:
+	// Where someone's current streak (weeks absent on the last Sunday) puts them
+	enum Bucket
+	{
+		WEEKS_0,
+		WEEKS_1,
+		WEEKS_2,
+		WEEKS_3,
+		WEEKS_4,
+		WEEKS_5,
+		WEEKS_6_PLUS,
+		OFF_ROLL, // membership removed, weeks absent is 99
+		BUCKET_COUNT,
+	};
+
+	explicit RollIndex(std::shared_ptr<const eya::AnalysisResult> result);
+
+	const eya::AnalysisResult& Result() const { return *result; }
+
+	// Members called "first last", ignoring case
+	const std::vector<uint32_t>& ByName(const std::string& name) const;
+
+	const std::vector<uint32_t>& ByBucket(Bucket bucket) const { return buckets[bucket]; }
+	const std::vector<uint32_t>& ByMemberType(person::MemberType memberType) const { return memberTypes[static_cast<std::size_t>(memberType)]; }
+
+	// Streaks as of any Sunday, not just the last one
+	const StreakIndex& Streaks() const { return streaks; }
+
+	// The Sunday columns (indexes into attendance_list) that fall in a month, empty when none do
+	void MonthColumns(int year, unsigned month, uint32_t& first, uint32_t& last) const;
+
+	static Bucket BucketFor(int32_t weeksAbsent);
+
+	// Lower case "first last", the key ByName looks up
+	static std::string NameKey(const std::string& firstName, const std::string& lastName);
+
+private:
+	std::shared_ptr<const eya::AnalysisResult> result;
+	std::unordered_map<std::string, std::vector<uint32_t>> names;
+	std::array<std::vector<uint32_t>, BUCKET_COUNT> buckets;
+	std::array<std::vector<uint32_t>, 4> memberTypes;
+	std::vector<int64_t> days; // day number (dates.h) of each Sunday column
+	StreakIndex streaks;
+};
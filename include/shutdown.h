@@ -0,0 +1,7 @@
+#pragma once
+
+// SIGINT and SIGTERM for the long-running modes (--watch, --serve), they ask to stop rather than killing the process
+
+void InstallStopHandlers();
+
+bool StopRequested();
@@ -0,0 +1,46 @@
+#pragma once
+#include "person.h"
+#include <cstdint>
+#include <vector>
+
+// Every member's weeks absent history as runs, so any Sunday can be asked about, not just the last one
+//  A run is consecutive Sunday columns where weeks absent either stays the same (present, off the roll, not taken,
+//  not seen yet) or goes up by one a week (absent after being seen), years of history come down to a few runs
+//  Runs for all members share flat arrays, member m owns runs [offsets[m], offsets[m + 1])
+
+class StreakIndex
+{
+public:
+	StreakIndex() = default;
+
+	// The roll must have been through CountAbsentWeeks, sundays holds the day number (dates.h) of each column in date order
+	StreakIndex(const std::vector<person>& classRoll, const std::vector<int64_t>& sundays);
+
+	// The last Sunday column on or before day, -1 when day is before the first one
+	int32_t ColumnAt(int64_t day) const;
+
+	// Weeks absent for one member as of a column, a binary search over their runs
+	int32_t WeeksAbsent(uint32_t member, int32_t column) const;
+
+	// Weeks absent for every member as of a column, one pass over the run arrays
+	void WeeksAbsentAll(int32_t column, std::vector<int32_t>& weeksAbsent) const;
+
+	// Whether a member's absence streak reached weeks in one of the columns (fromColumn, toColumn]
+	bool Crossed(uint32_t member, int32_t weeks, int32_t fromColumn, int32_t toColumn) const;
+
+	// Every member whose streak crossed
+	void CrossedAll(int32_t weeks, int32_t fromColumn, int32_t toColumn, std::vector<uint32_t>& members) const;
+
+	uint32_t MemberCount() const { return offsets.empty() ? 0 : static_cast<uint32_t>(offsets.size() - 1); }
+	std::size_t RunCount() const { return starts.size(); }
+
+private:
+	// Weeks absent at a column inside run r
+	int32_t ValueAt(uint32_t run, int32_t column) const { return values[run] + counting[run] * (column - starts[run]); }
+
+	std::vector<uint32_t> offsets{ 0 };
+	std::vector<int32_t> starts;   // first column of each run
+	std::vector<int32_t> values;   // weeks absent at that column
+	std::vector<int32_t> counting; // 1 when weeks absent goes up by one each column of the run, else 0
+	std::vector<int64_t> days;
+};
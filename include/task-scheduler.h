@@ -0,0 +1,136 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskGroup;
+
+// How the shared scheduler is set up, read when it first starts
+struct SchedulerOptions
+{
+	unsigned workers{ 0 };     // 0 means one per hardware thread
+	bool pin_threads{ false }; // pin worker i to the i-th CPU the process is allowed to run on
+};
+
+// One work-stealing scheduler for the whole process, every stage that splits its work hands the pieces to this
+//  Each worker has its own deque, it pushes and pops at the back so the newest and cache-warm task runs next, idle workers
+//  steal from the front of someone else's so they take the oldest and largest pieces, tasks from other threads go to a
+//  shared queue that every worker takes from too
+//  A thread waiting on a TaskGroup runs that group's tasks while it waits, so a task can wait on tasks of its own without using
+//  up a worker, and never anyone else's, which could hold it up for as long as they take or block on something it holds
+class TaskScheduler
+{
+public:
+	// Size the shared scheduler, returns false once something has already started it
+	static bool Configure(const SchedulerOptions& options);
+
+	// The shared scheduler, started the first time it's asked for
+	static TaskScheduler& Shared();
+
+	explicit TaskScheduler(const SchedulerOptions& options);
+
+	// Runs everything already submitted, then joins
+	~TaskScheduler();
+
+	TaskScheduler(const TaskScheduler&) = delete;
+	TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+	unsigned Size() const { return static_cast<unsigned>(workers.size()); }
+
+private:
+	friend class TaskGroup;
+
+	struct Task
+	{
+		std::function<void()> run;
+		TaskGroup* group;
+	};
+
+	struct Worker
+	{
+		std::mutex lock;
+		std::deque<Task> tasks;
+		std::thread thread;
+	};
+
+	void Submit(Task task);
+
+	// With a group, only one of that group's tasks
+	bool TryRunOne(const TaskGroup* group = nullptr);
+	bool Take(Task& task, const TaskGroup* group);
+	static bool TakeFrom(std::deque<Task>& tasks, bool newest, const TaskGroup* group, Task& task);
+
+	void Run(unsigned index, bool pin);
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::mutex injectedLock;
+	std::deque<Task> injected;
+
+	// Tasks in any deque, so a sleeping thread can tell there's something to take
+	std::atomic<std::size_t> queued{ 0 };
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	bool stopping{ false };
+};
+
+// Tasks that are waited for together
+//  The first exception a task throws is rethrown by Wait, the rest of the group still runs
+class TaskGroup
+{
+public:
+	explicit TaskGroup(TaskScheduler& scheduler = TaskScheduler::Shared()) : scheduler(scheduler) {}
+
+	// Waits, swallowing any exception, call Wait first to see it
+	~TaskGroup();
+
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+
+	void Run(std::function<void()> task);
+
+	// Block until every task run so far has finished, running this group's tasks meanwhile
+	void Wait();
+
+	unsigned Size() const { return scheduler.Size(); }
+
+private:
+	friend class TaskScheduler;
+
+	void Finished(std::exception_ptr error);
+
+	TaskScheduler& scheduler;
+	std::atomic<std::size_t> pending{ 0 };
+	std::atomic<std::size_t> unstarted{ 0 }; // still in a deque, so Wait can tell whether there's any of its own to take
+	std::mutex errorLock;
+	std::exception_ptr error{};
+};
+
+// body(pieceBegin, pieceEnd) over [begin, end) in pieces of grain, piece k starting at begin + k * grain, then wait for all of them
+//  Runs inline when it's a single piece or there's a single worker
+template <typename Body>
+void ParallelFor(std::size_t begin, std::size_t end, std::size_t grain, Body&& body, TaskScheduler& scheduler = TaskScheduler::Shared())
+{
+	grain = std::max<std::size_t>(grain, 1);
+	if (end <= begin + grain || scheduler.Size() < 2)
+	{
+		if (begin < end)
+			body(begin, end);
+		return;
+	}
+
+	TaskGroup group{ scheduler };
+	for (std::size_t piece = begin; piece < end; piece += grain)
+	{
+		const std::size_t pieceEnd{ std::min(piece + grain, end) };
+		group.Run([&body, piece, pieceEnd] { body(piece, pieceEnd); });
+	}
+	group.Wait();
+}
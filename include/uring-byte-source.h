@@ -0,0 +1,12 @@
+#pragma once
+#include "csv.h"
+#include <memory>
+#include <string>
+
+// Reads an export with several blocks queued at once through io_uring, for volumes where each read waits on the network
+//  Blocks complete in any order into a ring of aligned buffers and are handed to the line reader in file order, each one
+//  consumed is queued again further along the file, so the reads in flight stay ahead of parsing
+
+// nullptr when io_uring can't be used (not Linux, an old kernel, turned off or blocked by seccomp), the file can't be opened,
+// or it's compressed, the caller falls back to LineReader's own reader
+std::unique_ptr<io::ByteSourceBase> OpenUringByteSource(const std::string& filePath);
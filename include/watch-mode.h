@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+class QueryServer;
+
+namespace eya
+{
+	class OutreachRules;
+}
+
+// --watch, a long-running mode that processes every export dropped into a directory
+
+struct WatchOptions
+{
+	std::string directory{};
+	std::string output_directory{}; // defaults to a reports folder inside the watched directory
+	uint32_t settle_ms{ 1000 };     // how long a file has to sit unchanged before it is read
+	const eya::OutreachRules* outreach_rules{ nullptr }; // the long-standing ladder when not set
+	uint32_t top_k{ 0 };            // also write the k members most at risk, 0 for no at-risk file
+	bool outreach_only{ false };    // only the outreach file, skipping everything that needs every Sunday kept
+};
+
+// Runs until SIGINT or SIGTERM, then finishes the exports already queued, returns the exit code
+//  With a server, it answers questions about the newest export processed so far, by the date in its name, and for the
+//  same date the one that started last, so an older export that finishes late doesn't replace it
+int RunWatchMode(const WatchOptions& options, QueryServer* server = nullptr);
@@ -0,0 +1,27 @@
+// allocation-hook.cpp : Replaceable operator new/delete feeding the --profile allocation counters
+//  Compiled into each executable rather than libeya-attendance, a replacement that lives in a static library
+//  is only linked in when something else pulls in its object file, and nothing does
+//
+
+#include "profiler.h"
+#include <cstdlib>
+#include <new>
+
+// Replaceable global allocation functions, the array and nothrow forms forward here by default
+void* operator new(std::size_t size)
+{
+    ProfileRecordAllocation(size);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
@@ -0,0 +1,71 @@
+// attendance-history.cpp : Per member run-length or packed attendance statuses
+//
+
+#include "attendance-history.h"
+
+namespace
+{
+    // Bytes the run container would need, without writing anything
+    std::size_t RunBytes(const uint8_t* statuses, uint32_t columns)
+    {
+        std::size_t bytes{ 0 };
+        for (uint32_t begin = 0; begin < columns;)
+        {
+            uint32_t end{ begin + 1 };
+            while (end < columns && statuses[end] == statuses[begin])
+                ++end;
+
+            // Head byte, then 7 bits per byte for what doesn't fit in its 4
+            ++bytes;
+            for (uint32_t rest = (end - begin - 1) >> 4; rest; rest >>= 7)
+                ++bytes;
+            begin = end;
+        }
+        return bytes;
+    }
+}
+
+// Compress one member's statuses, whichever container is smaller, returns the one chosen
+AttendanceHistory::Container AttendanceHistory::Add(const uint8_t* statuses, uint32_t columns)
+{
+    const std::size_t packedBytes{ (static_cast<std::size_t>(columns) + 1) / 2 };
+    const std::size_t runBytes{ RunBytes(statuses, columns) };
+
+    // Ties go to packed, it decodes without branching on run lengths
+    Entry entry{ static_cast<uint32_t>(data.size()), columns, runBytes < packedBytes ? Container::RUNS : Container::PACKED };
+    if (entry.container == Container::PACKED)
+    {
+        data.resize(data.size() + packedBytes, 0);
+        uint8_t* p{ data.data() + entry.offset };
+        for (uint32_t column = 0; column < columns; ++column)
+            p[column / 2] |= static_cast<uint8_t>(statuses[column] << (column % 2 * 4));
+    }
+    else
+    {
+        for (uint32_t begin = 0; begin < columns;)
+        {
+            uint32_t end{ begin + 1 };
+            while (end < columns && statuses[end] == statuses[begin])
+                ++end;
+
+            uint32_t length{ end - begin - 1 };
+            uint32_t rest{ length >> 4 };
+            data.push_back(static_cast<uint8_t>(statuses[begin] << 5 | (rest ? 0x10 : 0) | (length & 0x0f)));
+            while (rest)
+            {
+                data.push_back(static_cast<uint8_t>((rest & 0x7f) | (rest > 0x7f ? 0x80 : 0)));
+                rest >>= 7;
+            }
+            begin = end;
+        }
+    }
+
+    entries.push_back(entry);
+    return entry.container;
+}
+
+void AttendanceHistory::ShrinkToFit()
+{
+    entries.shrink_to_fit();
+    data.shrink_to_fit();
+}
@@ -0,0 +1,1597 @@
+// attendance.cpp : The attendance pipeline stages, from a Planning Center export to the report and outreach files
+//
+
+#include "attendance.h"
+#include "csv.h"
+#include "dates.h"
+#include "names.h"
+#include "profiler.h"
+#include "task-scheduler.h"
+#include <sstream>
+#include <filesystem>
+#include <unordered_set>
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+
+// Parse a header date, m/d/yyyy with any single character between the fields, into a day number (see dates.h)
+bool ParseHeaderDate(const std::string& date, int64_t& day)
+{
+    int d, m, y;
+    std::istringstream is(date);
+    char delimiter;
+    if (!(is >> m >> delimiter >> d >> delimiter >> y))
+        return false;
+
+    // Reject anything mktime would have normalized into another day, e.g. 29/02/2013 would become 01/03/2013
+    if (m < 1 || m > 12 || d < 1 || static_cast<unsigned>(d) > DaysInMonth(y, static_cast<unsigned>(m)))
+        return false;
+
+    day = DaysFromCivil(y, static_cast<unsigned>(m), static_cast<unsigned>(d));
+    return true;
+}
+
+// Validates an input string is in a valid date format and is a Sunday
+//  Pure calendar math rather than mktime/localtime, localtime shares one buffer between threads
+bool ValidDateFormat(const std::string& date)
+{
+    int64_t day;
+    return ParseHeaderDate(date, day) && WeekdayFromDays(day) == 0;
+}
+
+namespace
+{
+    // The export's own name, without the .gz or .zst of a compressed copy
+    std::filesystem::path ExportPath(const std::string& filePath)
+    {
+        std::filesystem::path path{ filePath };
+        if (path.extension() == ".gz" || path.extension() == ".zst")
+            path.replace_extension();
+        return path;
+    }
+}
+
+// Validates an input file path is a valid file and has a .csv extension, .csv.gz and .csv.zst when this build can decompress them
+bool IsValidCSV(const std::string& filePath, eya::Diagnostics& diagnostics)
+{
+    // Check if the file exists
+    if (!std::filesystem::exists(filePath)) {
+        diagnostics.push_back({ eya::Diagnostic::Severity::ERROR, "File does not exist: " + filePath });
+        return false;
+    }
+
+    // Check if the file has a .csv extension
+    if (ExportPath(filePath).extension() != ".csv") {
+        diagnostics.push_back({ eya::Diagnostic::Severity::ERROR, "File is not a CSV file: " + filePath });
+        return false;
+    }
+
+    // Check a compressed CSV can be read by this build
+    if (!io::can_decompress(filePath.c_str())) {
+        diagnostics.push_back({ eya::Diagnostic::Severity::ERROR, "This build can't decompress " + std::filesystem::path(filePath).extension().string() + " files: " + filePath });
+        return false;
+    }
+
+    // Additional checks specific to CSV format can be added if necessary
+
+    // If both checks pass, consider it a valid CSV file
+    return true;
+}
+
+// From an input file path, scrub the file name for the date
+bool ScrubDateFromFileName(const std::string& filePath, std::string& date)
+{
+    // Tokenize the header row
+    std::istringstream split(ExportPath(filePath).stem().string());
+    std::vector<std::string> tokens;
+
+    // Push each field into the headers array
+    for (std::string each; std::getline(split, each, '-'); tokens.push_back(each));
+
+    // The file name convention (as of 1/15/24) is "attendance-report-young-adults-yyyy-mm-dd-yyyy-mm-dd.csv"
+    if (tokens.size() != 10 || (tokens[0] != "attendance" || tokens[1] != "report" || tokens[2] != "young" || tokens[3] != "adults"))
+        return false;
+
+    // We're grabbing the last 3 tokens (the second date) for the date, that should be the last day of the report time (when it's ran)
+    date = tokens[7] + "-" + tokens[8] + "-" + tokens[9];
+
+    return true;
+}
+
+// Retrieve the first row, "header row", from the csv, the line reader drops a UTF-8 BOM and a trailing '\r'
+bool GetHeaderRow(io::LineReader& in, std::string& headerRow)
+{
+    // Get the header row (first row to the newline)
+    try
+    {
+        const char* line = in.next_line();
+        if (line == nullptr)
+            return false;
+        headerRow = line;
+    }
+    catch (...)
+    {
+        return false;
+    }
+    ProfileAddBytesRead(headerRow.size() + 1);
+
+    return true;
+}
+
+// Check a header date, parsing it only the first time it is seen
+bool SundayTable::IsValidSunday(const std::string& date)
+{
+    {
+        std::shared_lock<std::shared_mutex> guard(lock);
+        auto found = sundays.find(date);
+        if (found != sundays.end())
+            return found->second;
+    }
+
+    const bool valid{ ValidDateFormat(date) };
+    std::unique_lock<std::shared_mutex> guard(lock);
+    sundays.emplace(date, valid);
+    return valid;
+}
+
+std::size_t SundayTable::Size() const
+{
+    std::shared_lock<std::shared_mutex> guard(lock);
+    return sundays.size();
+}
+
+// Add everyone in the roll, returns how many weren't in the index yet
+uint32_t MemberIndex::Update(const std::vector<person>& classRoll)
+{
+    uint32_t added{ 0 };
+    std::string key;
+    std::unique_lock<std::shared_mutex> guard(lock);
+    for (const auto& member : classRoll)
+    {
+        key.assign(member.first_name).append(1, ',').append(member.last_name);
+        if (members.emplace(key, static_cast<uint32_t>(members.size())).second)
+            ++added;
+    }
+    return added;
+}
+
+std::size_t MemberIndex::Size() const
+{
+    std::shared_lock<std::shared_mutex> guard(lock);
+    return members.size();
+}
+
+// Tokenize the header row, assuming comma separation, into a vector of headers
+bool TokenizeHeaderRow(const std::string& headerRow, std::vector<std::string>& headers, eya::Diagnostics& diagnostics, SundayTable* sundays)
+{
+    // Tokenize the header row
+    std::istringstream split(headerRow);
+
+    // Push each field into the headers array
+    for (std::string each; std::getline(split, each, ','); headers.push_back(each));
+
+    // Make sure we have basic data, sizes, and known fields
+    if (!headers.empty() && headers.size() > 3 && headers[0] == "first name" && headers[1] == "last name" && headers[2] == "percent")
+    {
+        // Erase all the headers we don't care about, keep the name, and Sundays
+        auto erased = std::erase_if(headers, [&](const std::string& s)
+            {
+                if (s == "first name" || s == "last name" || /*s == "percent" ||*/ (sundays ? sundays->IsValidSunday(s) : ValidDateFormat(s)))
+                    return false;
+                else
+                    return true;
+            });
+        
+        if (erased > 0)
+        {
+            diagnostics.push_back({ eya::Diagnostic::Severity::INFO, "Erased " + std::to_string(erased) + " event(s) that were not on Sunday or an invalid date format" });
+        }
+
+        // Added a continue in parse_header_line() of csv.h to allow for parsing of CSVs with duplicate headers.
+        //  This seems to work somehow, it prevents throwing the error::duplicated_column_in_header error
+        // 
+        // Erase duplicates in the headers vector by trying to put each header into
+        //  an unordered_set, if the insert fails (do to being duplicate), erase it
+        // This assumes that the FIRST EVENT on a Sunday is Sunday School
+        // The set is per call, a static one would treat every header as a duplicate the second time around
+        std::unordered_set<std::string> seenWords;
+        erased = std::erase_if(headers, [&](const std::string& s)
+            {
+                return seenWords.insert(s).second == false;
+            });
+
+        if (erased > 0)
+        {
+            diagnostics.push_back({ eya::Diagnostic::Severity::INFO, "Erased " + std::to_string(erased) + " event(s) that were on Sunday, but probably were not Sunday School" });
+        }
+
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+namespace
+{
+    constexpr uint8_t StatusCode(person::AttendanceType type)
+    {
+        return static_cast<uint8_t>(type);
+    }
+
+    constexpr uint8_t StatusCode(person::AttendanceType type, person::MemberType memberType)
+    {
+        return static_cast<uint8_t>(static_cast<uint8_t>(type) | (static_cast<uint8_t>(memberType) + 1) << 3);
+    }
+
+    // Whether text starts at p, stopping at the first difference so it never reads past the end of the line
+    template <std::size_t N>
+    bool StartsWith(const char* p, const char (&text)[N])
+    {
+        for (std::size_t i = 0; i + 1 < N; ++i)
+        {
+            if (p[i] != text[i])
+                return false;
+        }
+        return true;
+    }
+}
+
+// A status exactly as the export writes it, returning where the cell ends, nullptr for anything else
+//  The first letter, and the thirteenth after "attended as ", say which status it can only be, so each cell is one compare
+const char* StatusCodec::match(const char* begin, char sep, uint8_t& code)
+{
+    const char* end{ nullptr };
+    if (*begin == sep || *begin == '\0')
+    {
+        code = StatusCode(person::AttendanceType::NOT_PRESENT);
+        return begin;
+    }
+    else if (*begin == 'a' && StartsWith(begin, "attended as "))
+    {
+        const char* as{ begin + 12 };
+        if (*as == 'm' && StartsWith(as, "member"))
+        {
+            code = StatusCode(person::AttendanceType::PRESENT, person::MemberType::MEMBER);
+            end = as + 6;
+        }
+        else if (*as == 'l' && StartsWith(as, "leader"))
+        {
+            code = StatusCode(person::AttendanceType::PRESENT, person::MemberType::LEADER);
+            end = as + 6;
+        }
+        else if (*as == 'v' && StartsWith(as, "visitor"))
+        {
+            code = StatusCode(person::AttendanceType::VISITING, person::MemberType::VISITOR);
+            end = as + 7;
+        }
+    }
+    else if (*begin == 'a' && StartsWith(begin, "attendance not taken"))
+    {
+        code = StatusCode(person::AttendanceType::NOT_TAKEN);
+        end = begin + 20;
+    }
+    else if (*begin == 'm' && StartsWith(begin, "membership removed"))
+    {
+        code = StatusCode(person::AttendanceType::NA);
+        end = begin + 18;
+    }
+
+    // Anything after it, trailing spaces included, goes the long way
+    return end && (*end == sep || *end == '\0') ? end : nullptr;
+}
+
+// One status cell as a code, the length picks the one or three strings it could be so each cell is at most three compares
+//  Membership removed leaves the member type alone, to ensure we always know what they were last (in case someone was removed)
+uint8_t StatusCodec::decode(const char* begin, const char* end)
+{
+    const std::string_view status(begin, static_cast<std::size_t>(end - begin));
+    switch (status.size())
+    {
+    case 0:
+        return StatusCode(person::AttendanceType::NOT_PRESENT);
+    case 18:
+        if (status == "attended as member")
+            return StatusCode(person::AttendanceType::PRESENT, person::MemberType::MEMBER);
+        if (status == "attended as leader")
+            return StatusCode(person::AttendanceType::PRESENT, person::MemberType::LEADER);
+        break;
+    case 19:
+        if (status == "attended as visitor")
+            return StatusCode(person::AttendanceType::VISITING, person::MemberType::VISITOR);
+        break;
+    case 20:
+        if (status == "attendance not taken")
+            return StatusCode(person::AttendanceType::NOT_TAKEN);
+        break;
+    }
+
+    // "membership removed", and anything else
+    return StatusCode(person::AttendanceType::NA);
+}
+
+// Convert one attendance cell into an attendance type, updating memberType when the cell says how they attended
+person::AttendanceType ClassifyStatus(std::string_view status, person::MemberType& memberType)
+{
+    return StatusCodec::Apply(StatusCodec::decode(status.data(), status.data() + status.size()), memberType);
+}
+
+namespace
+{
+    // The export's layout, first and last name, the percent column, and a status for each Sunday
+    using RollReader = io::schema_reader<2, StatusCodec, NameCodec>;
+
+    // A batch holds this many bytes of status codes, with the names and percents alongside that's still well inside L2
+    constexpr std::size_t batchCodeBytes{ 32 * 1024 };
+
+    // Members per task when a stage splits the roll across the scheduler, about 64K Sunday cells each, enough work to be
+    //  worth a task and small enough that the pieces even out between workers
+    std::size_t MembersPerTask(std::size_t sundays)
+    {
+        return std::max<std::size_t>((std::size_t{ 1 } << 16) / std::max<std::size_t>(sundays, 1), 1);
+    }
+
+    // One member's running weeks absent, a Sunday at a time
+    struct AbsenceCounter
+    {
+        bool seen;
+        int32_t longest_streak;
+        int32_t weeks_absent{ 99 };
+
+        int32_t Next(person::AttendanceType type)
+        {
+            // If they are marked present or visiting reset their absent count and their seen variable
+            if (type == person::AttendanceType::PRESENT ||
+                type == person::AttendanceType::VISITING)
+            {
+                if (!seen)
+                    seen = true;
+                weeks_absent = 0;
+            }
+            // If they are marked not present and they have been seen, increment weeks absent
+            else if (type == person::AttendanceType::NOT_PRESENT)
+            {
+                if (seen)
+                    weeks_absent++;
+            }
+            // If they are marked n/a they aren't on the role and weren't there, set their seen to false and weeks absent to 99
+            else if (type == person::AttendanceType::NA)
+            {
+                seen = false;
+                weeks_absent = 99;
+            }
+
+            // Once a streak gets long enough they've "been through the process", the outreach rules decide how long that is
+            if (seen && weeks_absent > longest_streak)
+            {
+                longest_streak = weeks_absent;
+            }
+            return weeks_absent;
+        }
+    };
+}
+
+namespace
+{
+    // A reader for the rows under headerRow, every column in the file mapped to the header it fills, or -1 to skip it
+    //  Like CSVReader::read_header only the first of a duplicated column is used
+    RollReader MakeRollReader(const std::string& headerRow, const std::vector<std::string>& headers)
+    {
+        using trim_policy = io::trim_chars<' ', '\t'>;
+        using quote_policy = io::no_quote_escape<','>;
+
+        const uint32_t actualNumHeaders{ static_cast<uint32_t>(headers.size()) };
+        std::vector<char> headerLine(headerRow.c_str(), headerRow.c_str() + headerRow.size() + 1);
+        char* line = headerLine.data();
+        std::vector<int> colOrder;
+        std::vector<bool> found(actualNumHeaders + 1, false);
+        while (line)
+        {
+            char* colBegin, * colEnd;
+            io::detail::chop_next_column<quote_policy>(line, colBegin, colEnd);
+            trim_policy::trim(colBegin, colEnd);
+
+            int index{ -1 };
+            for (uint32_t i = 0; i < actualNumHeaders; ++i)
+            {
+                if (!found[i] && colBegin == headers[i])
+                {
+                    found[i] = true;
+                    index = static_cast<int>(i);
+                    break;
+                }
+            }
+            if (index < 0 && !found[actualNumHeaders] && std::strcmp(colBegin, "percent") == 0)
+            {
+                found[actualNumHeaders] = true;
+                index = static_cast<int>(actualNumHeaders);
+            }
+            colOrder.push_back(index);
+        }
+
+        return RollReader(std::move(colOrder), actualNumHeaders > 2 ? actualNumHeaders - 2 : 0, static_cast<int>(actualNumHeaders));
+    }
+}
+
+// Every row after the header row, a batch at a time, the roll builders below are loops over these
+//  Each row is split by RollReader, then its names, percent and status codes are copied into the batch, the coroutine only
+//  suspends when a batch is full (or at the end), so a stage runs over a few hundred rows at a time
+Generator<RowBatch> ReadRowBatches(io::LineReader& in, const std::string& headerRow, const std::vector<std::string>& headers, io::parse_diagnostics* rejected)
+{
+    const uint32_t actualNumHeaders{ static_cast<uint32_t>(headers.size()) };
+    const uint32_t columns{ actualNumHeaders > 2 ? actualNumHeaders - 2 : 0 };
+    RollReader reader{ MakeRollReader(headerRow, headers) };
+    uint64_t bytesRead{ 0 };
+    uint64_t rows{ 0 };
+
+    const uint32_t capacity{ static_cast<uint32_t>(std::clamp<std::size_t>(batchCodeBytes / std::max<uint32_t>(columns, 1), 16, 4096)) };
+    RowBatch batch;
+    batch.columns = columns;
+    batch.codes.resize(std::size_t{ capacity } * columns);
+    batch.percents.resize(capacity);
+    batch.name_ends.reserve(2 * std::size_t{ capacity });
+
+    // While we can read a new row of data from the csv...
+    char* line;
+    while ((line = in.next_line()) != nullptr)
+    {
+        if (ProfilingEnabled())
+            bytesRead += std::strlen(line) + 1;
+
+        // Columns missing from the header read as empty cells, only lines with a quote in them pay for quote handling
+        unsigned column;
+        const io::parse_error reason{ reader.parse(line, column, in.line_has_quote()) };
+        if (reason != io::parse_error::none)
+        {
+            if (rejected)
+                rejected->add(in.get_file_line(), column, reason);
+            continue;
+        }
+
+        const uint32_t row{ batch.rows++ };
+        std::memcpy(batch.codes.data() + std::size_t{ row } * columns, reader.status_codes().data(), columns);
+        batch.percents[row] = reader.number();
+        batch.names.append(reader.name(0));
+        batch.name_ends.push_back(static_cast<uint32_t>(batch.names.size()));
+        batch.names.append(reader.name(1));
+        batch.name_ends.push_back(static_cast<uint32_t>(batch.names.size()));
+        ++rows;
+
+        if (batch.rows == capacity)
+        {
+            co_yield batch;
+            batch.rows = 0;
+            batch.names.clear();
+            batch.name_ends.clear();
+        }
+    }
+    if (batch.rows > 0)
+        co_yield batch;
+
+    ProfileAddBytesRead(bytesRead);
+    ProfileAddRows(rows);
+    ProfileAddCells(rows * columns);
+}
+
+// Use the rest of the line reader (after the header row) and the headers to create a roll vector containing everyone's attendance
+//  The column count comes from the header row, so there is no limit on the number of Sundays
+//  With more than one worker, each batch is turned into people on the scheduler while the next batch is being split
+bool CreateClassRollVector(io::LineReader& in, const std::string& headerRow, const std::vector<std::string>& headers, std::vector<person>& classRoll,
+    io::parse_diagnostics* rejected)
+{
+    const uint32_t actualNumHeaders{ static_cast<uint32_t>(headers.size()) };
+    const auto addRows = [&](const RowBatch& batch, std::vector<person>& people)
+        {
+            for (uint32_t row = 0; row < batch.rows; ++row)
+            {
+                // Create a person and put data within
+                person tmpPerson;
+                tmpPerson.first_name = batch.FirstName(row);
+                tmpPerson.last_name = batch.LastName(row);
+                tmpPerson.percent = batch.percents[row];
+
+                // For each day, convert the attendance code into an enumeration that can be used
+                const uint8_t* codes{ batch.Codes(row) };
+                person::MemberType memberType{ person::MemberType::NA };
+                tmpPerson.attendance_list.reserve(actualNumHeaders - 2);
+                for (uint32_t i = 2; i < actualNumHeaders; ++i)
+                {
+                    person::AttendanceType attendanceType{ StatusCodec::Apply(codes[i - 2], memberType) };
+
+                    tmpPerson.member_type = memberType;
+                    tmpPerson.attendance_list.push_back({ headers[i], attendanceType, StatusCodec::AttendedAs(codes[i - 2]) });
+                }
+
+                people.emplace_back(std::move(tmpPerson));
+            }
+        };
+
+    try
+    {
+        TaskScheduler& scheduler{ TaskScheduler::Shared() };
+        if (scheduler.Size() < 2)
+        {
+            for (const RowBatch& batch : ReadRowBatches(in, headerRow, headers, rejected))
+                addRows(batch, classRoll);
+            return true;
+        }
+
+        // A piece of the roll per batch, in file order, a deque so the pieces stay put while more are added
+        std::deque<std::vector<person>> pieces;
+        {
+            TaskGroup group{ scheduler };
+            for (const RowBatch& batch : ReadRowBatches(in, headerRow, headers, rejected))
+            {
+                std::vector<person>& piece{ pieces.emplace_back() };
+                group.Run([&addRows, &piece, batch] { addRows(batch, piece); });
+            }
+            group.Wait();
+        }
+
+        std::size_t members{ classRoll.size() };
+        for (const auto& piece : pieces)
+            members += piece.size();
+        classRoll.reserve(members);
+        for (auto& piece : pieces)
+            std::move(piece.begin(), piece.end(), std::back_inserter(classRoll));
+    }
+    catch (...)
+    {
+        return false;
+    }
+    return true;
+}
+
+namespace
+{
+    // One pass over each row keeping the last Sunday's weeks absent, member type and longest streak, and every status in history when given
+    bool CreateLastSundayRoll(io::LineReader& in, const std::string& headerRow, const std::vector<std::string>& headers, std::vector<person>& classRoll,
+        AttendanceHistory* history, io::parse_diagnostics* rejected)
+    {
+        const uint32_t actualNumHeaders{ static_cast<uint32_t>(headers.size()) };
+        std::vector<uint8_t> statuses(history && actualNumHeaders > 2 ? actualNumHeaders - 2 : 0);
+        try
+        {
+            for (const RowBatch& batch : ReadRowBatches(in, headerRow, headers, rejected))
+            {
+                for (uint32_t row = 0; row < batch.rows; ++row)
+                {
+                    person tmpPerson;
+                    tmpPerson.first_name = batch.FirstName(row);
+                    tmpPerson.last_name = batch.LastName(row);
+                    tmpPerson.percent = batch.percents[row];
+
+                    const uint8_t* codes{ batch.Codes(row) };
+                    AbsenceCounter counter{ false, 0 };
+                    person::AttendanceType attendanceType{ person::AttendanceType::NA };
+                    for (uint32_t i = 2; i < actualNumHeaders; ++i)
+                    {
+                        attendanceType = StatusCodec::Apply(codes[i - 2], tmpPerson.member_type);
+                        counter.Next(attendanceType);
+                        if (history)
+                            statuses[i - 2] = AttendanceHistory::Status(attendanceType, StatusCodec::AttendedAs(codes[i - 2]));
+                    }
+
+                    tmpPerson.seen = counter.seen;
+                    tmpPerson.longest_streak = counter.longest_streak;
+                    if (actualNumHeaders > 2)
+                        tmpPerson.attendance_list.push_back({ headers.back(), attendanceType, StatusCodec::AttendedAs(codes[actualNumHeaders - 3]), counter.weeks_absent });
+                    if (history)
+                        history->Add(statuses.data(), static_cast<uint32_t>(statuses.size()));
+
+                    classRoll.emplace_back(std::move(tmpPerson));
+                }
+            }
+        }
+        catch (...)
+        {
+            return false;
+        }
+        return true;
+    }
+}
+
+// The same, with everyone's attendance straight into history and nobody's ever held uncompressed, each member's attendance_list
+//  holds just the last Sunday with its weeks absent, as CreateOutreachRoll leaves it
+bool CreateCompressedRoll(io::LineReader& in, const std::string& headerRow, const std::vector<std::string>& headers, std::vector<person>& classRoll,
+    AttendanceHistory& history, io::parse_diagnostics* rejected)
+{
+    const bool read{ CreateLastSundayRoll(in, headerRow, headers, classRoll, &history, rejected) };
+    history.ShrinkToFit();
+    return read;
+}
+
+// Only what the outreach file needs, straight from each row in one pass: the last Sunday's weeks absent, member type and
+//  longest streak, nothing is kept per week so each member's attendance_list holds just the last Sunday
+bool CreateOutreachRoll(io::LineReader& in, const std::string& headerRow, const std::vector<std::string>& headers, std::vector<person>& classRoll,
+    io::parse_diagnostics* rejected)
+{
+    return CreateLastSundayRoll(in, headerRow, headers, classRoll, nullptr, rejected);
+}
+
+// Under --perf, run LineReader::next_line and RollReader::parse on their own so their counters aren't mixed in with building the roll
+//  The second pass drives the reader the way ReadRowBatches does, streaming lines straight into parse, so its stage includes
+//  next_line too and parse's own share is the difference from the first
+void MeasureParserStages(const std::string& filePath, const std::vector<std::string>& headers, eya::Diagnostics& diagnostics)
+{
+    try
+    {
+        // Pass 1, only split the file into lines
+        {
+            ProfileStage stage{ "LineReader::next_line" };
+            io::LineReader in(filePath);
+            uint64_t rows{ 0 }, bytes{ 0 };
+            while (char* line = in.next_line())
+            {
+                bytes += std::strlen(line) + 1;
+                ++rows;
+            }
+            ProfileAddRows(rows);
+            ProfileAddBytesRead(bytes);
+        }
+
+        // Pass 2, split every data row into the roll's columns and status codes
+        {
+            io::LineReader in(filePath);
+            std::string headerRow;
+            if (!GetHeaderRow(in, headerRow))
+                return;
+            RollReader reader{ MakeRollReader(headerRow, headers) };
+
+            ProfileStage stage{ "RollReader::parse" };
+            uint64_t rows{ 0 };
+            while (char* line = in.next_line())
+            {
+                // Ragged rows are CreateClassRollVector's problem, just don't count them
+                unsigned column;
+                if (reader.parse(line, column, in.line_has_quote()) == io::parse_error::none)
+                    ++rows;
+            }
+            ProfileAddRows(rows);
+            ProfileAddCells(rows * (headers.size() > 2 ? headers.size() - 2 : 0));
+        }
+    }
+    catch (io::error::base& err)
+    {
+        diagnostics.push_back({ eya::Diagnostic::Severity::WARNING, std::string("Failed measuring parser stages: ") + err.what() });
+    }
+}
+
+// For each person in the roll, iterate over all days and keep a running total of weeks absent, resetting when appropriate
+//  Members are independent, so large rolls are counted a piece at a time across the scheduler
+bool CountAbsentWeeks(std::vector<person>& classRoll)
+{
+    const std::size_t sundays{ classRoll.empty() ? 0 : classRoll[0].attendance_list.size() };
+    ParallelFor(0, classRoll.size(), MembersPerTask(sundays), [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                person& member{ classRoll[i] };
+                AbsenceCounter counter{ member.seen, member.longest_streak };
+                for (auto& attendance : member.attendance_list)
+                {
+                    attendance.weeks_absent = counter.Next(attendance.type);
+                }
+                member.seen = counter.seen;
+                member.longest_streak = counter.longest_streak;
+            }
+        });
+    ProfileAddRows(classRoll.size());
+    if (!classRoll.empty())
+        ProfileAddCells(static_cast<uint64_t>(classRoll.size()) * classRoll[0].attendance_list.size());
+    return true;
+}
+
+// Everyone's action this week from the rules, based on the last Sunday's weeks absent
+//  The roll is gathered into columns first so the rules see the whole roll in one pass
+void EvaluateOutreach(const eya::OutreachRules& rules, const std::vector<person>& classRoll, std::vector<eya::OutreachAction>& actions)
+{
+    const std::size_t count{ classRoll.size() };
+    std::vector<uint8_t> memberTypes(count);
+    std::vector<int32_t> weeksAbsent(count), longestStreaks(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const person& member{ classRoll[i] };
+        memberTypes[i] = static_cast<uint8_t>(member.member_type);
+        weeksAbsent[i] = member.attendance_list.empty() ? 99 : member.attendance_list.back().weeks_absent;
+        longestStreaks[i] = member.longest_streak;
+    }
+
+    actions.resize(count);
+    rules.Evaluate(memberTypes.data(), weeksAbsent.data(), longestStreaks.data(), count, actions.data());
+}
+
+// Everyone in the roll with an action this week
+void BuildOutreachList(const std::vector<person>& classRoll, const std::vector<eya::OutreachAction>& actions, std::vector<eya::OutreachEntry>& outreach)
+{
+    for (uint32_t i = 0; i < classRoll.size() && i < actions.size(); ++i)
+    {
+        if (actions[i] != eya::OutreachAction::NONE)
+            outreach.push_back({ i, actions[i], classRoll[i].attendance_list.back().weeks_absent });
+    }
+}
+
+namespace
+{
+    constexpr uint8_t presentType{ static_cast<uint8_t>(person::AttendanceType::PRESENT) };
+    constexpr uint8_t leadingFlag{ 8 }; // above every attendance type, set in a row byte when the cell says leader
+
+    // The counting behind both ComputeAnalytics, fillRow(i, row) writes member i's row bytes, at most columns, and returns how many
+    template <class FillRow>
+    bool ComputeAnalyticsRows(const std::vector<person>& classRoll, std::size_t columns, FillRow&& fillRow, eya::Analytics& analytics)
+    {
+        std::vector<uint32_t> present(columns), leading(columns), visiting(columns), absent(columns), notTaken(columns), offRoll(columns);
+        std::vector<uint8_t> row(columns);
+
+        constexpr uint8_t leadingType{ presentType | leadingFlag };
+        constexpr uint8_t visitingType{ static_cast<uint8_t>(person::AttendanceType::VISITING) };
+        constexpr uint8_t absentType{ static_cast<uint8_t>(person::AttendanceType::NOT_PRESENT) };
+        constexpr uint8_t notTakenType{ static_cast<uint8_t>(person::AttendanceType::NOT_TAKEN) };
+        constexpr uint8_t offRollType{ static_cast<uint8_t>(person::AttendanceType::NA) };
+
+        analytics.rates.assign(classRoll.size(), {});
+        analytics.percent_mismatches = 0;
+        for (std::size_t i = 0; i < classRoll.size(); ++i)
+        {
+            const person& member{ classRoll[i] };
+            const std::size_t count{ fillRow(i, row.data()) };
+
+            uint32_t attended{ 0 }, missed{ 0 };
+            for (std::size_t c = 0; c < count; ++c)
+            {
+                const uint8_t type{ row[c] };
+                present[c] += type == presentType;
+                leading[c] += type == leadingType;
+                visiting[c] += type == visitingType;
+                absent[c] += type == absentType;
+                notTaken[c] += type == notTakenType;
+                offRoll[c] += type == offRollType;
+                attended += (type == presentType) | (type == leadingType) | (type == visitingType);
+                missed += type == absentType;
+            }
+
+            // Rounded half up, the way Planning Center's percent column appears to be
+            eya::MemberRate& rate{ analytics.rates[i] };
+            rate.attended = attended;
+            rate.possible = attended + missed;
+            if (rate.possible > 0)
+                rate.percent = static_cast<int32_t>((100 * rate.attended + rate.possible / 2) / rate.possible);
+
+            if (member.percent >= 0 && rate.percent >= 0 && std::abs(member.percent - rate.percent) > 1)
+                ++analytics.percent_mismatches;
+        }
+
+        // Rolling averages skip Sundays nobody's attendance was taken, prefix sums over the ones it was
+        analytics.sundays.assign(columns, {});
+        std::vector<uint64_t> takenTotals{ 0 };
+        for (std::size_t c = 0; c < columns; ++c)
+        {
+            eya::SundayCounts& sunday{ analytics.sundays[c] };
+            sunday.members = present[c];
+            sunday.leaders = leading[c];
+            sunday.visitors = visiting[c];
+            sunday.absent = absent[c];
+            sunday.not_taken = notTaken[c];
+            sunday.off_roll = offRoll[c];
+
+            if (sunday.Headcount() + sunday.absent > 0)
+                takenTotals.push_back(takenTotals.back() + sunday.Headcount());
+
+            const std::size_t taken{ takenTotals.size() - 1 };
+            const auto average = [&](std::size_t weeks)
+                {
+                    const std::size_t span{ std::min(weeks, taken) };
+                    return span ? static_cast<double>(takenTotals[taken] - takenTotals[taken - span]) / span : 0.0;
+                };
+            sunday.average_4 = average(4);
+            sunday.average_12 = average(12);
+        }
+
+        ProfileAddRows(classRoll.size());
+        ProfileAddCells(static_cast<uint64_t>(classRoll.size()) * columns);
+        return true;
+    }
+}
+
+// Per Sunday headcounts, per member rates and rolling averages, from one pass over the status matrix
+//  Someone present is counted as a leader on the Sundays the cell says they attended as one, whatever they are now
+//  Each member's statuses are gathered into a byte row once, then added into separate per column counters,
+//  so the inner loop is compares and adds over contiguous arrays that the compiler vectorises
+bool ComputeAnalytics(const std::vector<person>& classRoll, eya::Analytics& analytics)
+{
+    const std::size_t columns{ classRoll.empty() ? 0 : classRoll[0].attendance_list.size() };
+    return ComputeAnalyticsRows(classRoll, columns, [&](std::size_t i, uint8_t* row)
+        {
+            const auto& attendanceList = classRoll[i].attendance_list;
+            const std::size_t count{ std::min(attendanceList.size(), columns) };
+            for (std::size_t c = 0; c < count; ++c)
+            {
+                const person::Attendance& attendance{ attendanceList[c] };
+                row[c] = static_cast<uint8_t>(static_cast<uint8_t>(attendance.type) | (attendance.attended_as == person::MemberType::LEADER ? leadingFlag : 0));
+            }
+            return count;
+        }, analytics);
+}
+
+// The same from a compressed roll's history, each row is decompressed straight into its bytes
+bool ComputeAnalytics(const std::vector<person>& classRoll, const AttendanceHistory& history, eya::Analytics& analytics)
+{
+    const std::size_t columns{ history.MemberCount() ? history.Columns(0) : 0 };
+    return ComputeAnalyticsRows(classRoll, columns, [&](std::size_t i, uint8_t* row)
+        {
+            std::size_t count{ 0 };
+            history.ForEachStatus(static_cast<uint32_t>(i), [&](uint8_t status)
+                {
+                    if (count < columns)
+                        row[count++] = static_cast<uint8_t>(status == AttendanceHistory::LEADING ? presentType | leadingFlag : status);
+                });
+            return count;
+        }, analytics);
+}
+
+namespace
+{
+    // The counting behind both ComputeCohorts, forEachType(i, visit) calls visit(type) for each of member i's Sundays in order
+    template <class ForEachType>
+    bool ComputeCohortsOver(const std::vector<std::string>& headers, std::size_t members, ForEachType&& forEachType, eya::Cohorts& cohorts)
+    {
+        // Each Sunday column's month as year * 12 + month - 1, -1 for a header that isn't a date
+        std::vector<int64_t> monthOf;
+        int64_t firstMonth{ std::numeric_limits<int64_t>::max() };
+        int64_t lastMonth{ -1 };
+        for (std::size_t i = 2; i < headers.size(); ++i)
+        {
+            int64_t day{ 0 };
+            int64_t month{ -1 };
+            if (ParseHeaderDate(headers[i], day))
+            {
+                int y;
+                unsigned m, d;
+                CivilFromDays(day, y, m, d);
+                month = static_cast<int64_t>(y) * 12 + m - 1;
+                firstMonth = std::min(firstMonth, month);
+                lastMonth = std::max(lastMonth, month);
+            }
+            monthOf.push_back(month);
+        }
+
+        cohorts = {};
+        if (lastMonth < 0)
+            return true;
+
+        const std::size_t months{ static_cast<std::size_t>(lastMonth - firstMonth + 1) };
+        for (std::size_t k = 0; k < months; ++k)
+        {
+            char name[48];
+            const int64_t month{ firstMonth + static_cast<int64_t>(k) };
+            std::snprintf(name, sizeof(name), "%04lld-%02lld", static_cast<long long>(month / 12), static_cast<long long>(month % 12 + 1));
+            cohorts.months.emplace_back(name);
+        }
+        for (auto& month : monthOf)
+            month = month < 0 ? -1 : month - firstMonth;
+
+        // Count members [begin, end) into sizes and retained
+        const auto count = [&](std::size_t begin, std::size_t end, uint32_t* sizes, uint32_t* retained)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    std::size_t column{ 0 };
+                    int64_t cohort{ -1 };
+                    int64_t counted{ -1 };
+                    forEachType(i, [&](person::AttendanceType type)
+                        {
+                            const std::size_t c{ column++ };
+                            if (c >= monthOf.size())
+                                return;
+                            const int64_t month{ monthOf[c] };
+                            if ((type != person::AttendanceType::PRESENT && type != person::AttendanceType::VISITING) || month < 0)
+                                return;
+
+                            // The first time seen flips true in CountAbsentWeeks
+                            if (cohort < 0)
+                            {
+                                cohort = month;
+                                ++sizes[cohort];
+                            }
+
+                            // Once per month is enough to count as still coming
+                            if (month != counted && month >= cohort)
+                            {
+                                ++retained[cohort * months + (month - cohort)];
+                                counted = month;
+                            }
+                        });
+                }
+            };
+
+        cohorts.sizes.assign(months, 0);
+        cohorts.retained.assign(months * months, 0);
+
+        // Small rolls aren't worth waking threads for, a year of a few thousand members takes well under a millisecond
+        const uint64_t cells{ static_cast<uint64_t>(members) * monthOf.size() };
+        const unsigned workers{ TaskScheduler::Shared().Size() };
+        if (cells < (uint64_t{ 1 } << 22) || workers < 2)
+        {
+            count(0, members, cohorts.sizes.data(), cohorts.retained.data());
+        }
+        else
+        {
+            // Every chunk gets its own matrix, so nothing is shared until the sum
+            const std::size_t chunks{ workers };
+            std::vector<std::vector<uint32_t>> sizes(chunks, std::vector<uint32_t>(months));
+            std::vector<std::vector<uint32_t>> retained(chunks, std::vector<uint32_t>(months * months));
+            const std::size_t perChunk{ (members + chunks - 1) / chunks };
+            ParallelFor(0, members, perChunk, [&](std::size_t begin, std::size_t end)
+                {
+                    const std::size_t chunk{ begin / perChunk };
+                    count(begin, end, sizes[chunk].data(), retained[chunk].data());
+                });
+
+            for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+            {
+                for (std::size_t k = 0; k < months; ++k)
+                    cohorts.sizes[k] += sizes[chunk][k];
+                for (std::size_t k = 0; k < months * months; ++k)
+                    cohorts.retained[k] += retained[chunk][k];
+            }
+        }
+
+        ProfileAddRows(members);
+        ProfileAddCells(cells);
+        return true;
+    }
+}
+
+// Group everyone by the month they were first seen and count who attended in each month after, in one pass over the roll
+//  Large rolls are split across worker threads, each counting into its own matrix, and the matrices summed at the end
+//  Columns are expected in date order, as Planning Center writes them
+bool ComputeCohorts(const std::vector<std::string>& headers, const std::vector<person>& classRoll, eya::Cohorts& cohorts)
+{
+    return ComputeCohortsOver(headers, classRoll.size(), [&](std::size_t i, auto&& visit)
+        {
+            for (const auto& attendance : classRoll[i].attendance_list)
+                visit(attendance.type);
+        }, cohorts);
+}
+
+// The same from a compressed roll's history, decompressing each member as it's counted
+bool ComputeCohorts(const std::vector<std::string>& headers, const AttendanceHistory& history, eya::Cohorts& cohorts)
+{
+    return ComputeCohortsOver(headers, history.MemberCount(), [&](std::size_t i, auto&& visit) { history.ForEach(static_cast<uint32_t>(i), visit); }, cohorts);
+}
+
+namespace
+{
+    constexpr const char* outreachStateHeader{ "First Name,Last Name,Occurrence,Action,Weeks Absent" };
+
+    // Which of the people with that name each member is, 1 for the first on the roll, so people sharing a name stay apart
+    std::vector<uint32_t> NameOccurrences(const std::vector<person>& classRoll)
+    {
+        std::unordered_map<std::string, uint32_t> counts;
+        counts.reserve(classRoll.size());
+        std::vector<uint32_t> occurrences(classRoll.size());
+        std::string key;
+        for (std::size_t i = 0; i < classRoll.size(); ++i)
+        {
+            key.assign(classRoll[i].first_name).append(1, ',').append(classRoll[i].last_name);
+            occurrences[i] = ++counts[key];
+        }
+        return occurrences;
+    }
+
+    // A whole field as a number
+    template <typename T>
+    bool ParseWhole(std::string_view field, T& value)
+    {
+        const auto [last, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+        return ec == std::errc() && last == field.data() + field.size();
+    }
+
+    // first,last,occurrence
+    void OutreachKey(std::string& key, const std::string& firstName, const std::string& lastName, uint32_t occurrence)
+    {
+        key.assign(firstName).append(1, ',').append(lastName).append(1, ',').append(std::to_string(occurrence));
+    }
+
+    // A name as a csv field, quoted with any quotes doubled only when it holds a comma or a quote, the way the export writes it
+    struct CsvName
+    {
+        const std::string& text;
+    };
+
+    std::ostream& operator<<(std::ostream& out, CsvName name)
+    {
+        if (name.text.find_first_of(",\"") == std::string::npos)
+            return out << name.text;
+
+        out << '"';
+        for (const char c : name.text)
+        {
+            if (c == '"')
+                out << '"';
+            out << c;
+        }
+        return out << '"';
+    }
+
+    // Split a line of a file we wrote into its fields, undoing CsvName's quoting
+    void SplitFields(std::string_view line, std::vector<std::string>& fields)
+    {
+        fields.clear();
+        fields.emplace_back();
+        bool quoted{ false };
+        for (std::size_t i = 0; i < line.size(); ++i)
+        {
+            if (line[i] == '"' && (quoted || fields.back().empty()))
+            {
+                if (quoted && i + 1 < line.size() && line[i + 1] == '"')
+                    fields.back().push_back(line[++i]);
+                else
+                    quoted = !quoted;
+            }
+            else if (line[i] == ',' && !quoted)
+                fields.emplace_back();
+            else
+                fields.back().push_back(line[i]);
+        }
+    }
+}
+
+// Read back an outreach state file, returns false with the line at fault
+bool ReadOutreachStateFile(std::istream& in, eya::OutreachState& state, std::string& error)
+{
+    state.clear();
+    uint32_t lineNumber{ 0 };
+    std::vector<std::string> fields;
+    for (std::string line; std::getline(in, line);)
+    {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if (lineNumber == 1)
+        {
+            if (line != outreachStateHeader)
+            {
+                error = "Line 1: expected the header \"" + std::string(outreachStateHeader) + "\", got \"" + line + "\"";
+                return false;
+            }
+            continue;
+        }
+        if (line.empty())
+            continue;
+
+        SplitFields(line, fields);
+
+        eya::OutreachStateEntry entry;
+        bool valid{ fields.size() == 5 };
+        if (valid)
+        {
+            entry.first_name = fields[0];
+            entry.last_name = fields[1];
+            for (auto action : { eya::OutreachAction::TEXT, eya::OutreachAction::POST_CARD, eya::OutreachAction::PHONE_CALL, eya::OutreachAction::VISIT })
+            {
+                if (fields[3] == eya::ToString(action))
+                    entry.action = action;
+            }
+            valid = ParseWhole(fields[2], entry.occurrence) && entry.occurrence > 0 && entry.action != eya::OutreachAction::NONE &&
+                ParseWhole(fields[4], entry.weeks_absent);
+        }
+        if (!valid)
+        {
+            error = "Line " + std::to_string(lineNumber) + ": expected \"<first name>,<last name>,<occurrence>,<Text|Post Card|Phone Call|Visit>,<weeks absent>\", got \"" + line + "\"";
+            return false;
+        }
+        state.push_back(std::move(entry));
+    }
+
+    if (lineNumber == 0)
+    {
+        error = "Empty outreach state file";
+        return false;
+    }
+    return true;
+}
+
+// What changed since the previous run's state, a hash join on name and occurrence, built on the previous list and probed with the roll
+//  Anyone whose action is the same as last time is left out
+void DiffOutreach(const eya::OutreachState& previous, const std::vector<person>& classRoll, const std::vector<eya::OutreachAction>& actions, eya::OutreachDelta& delta)
+{
+    // Build, the first of a repeated key wins
+    std::unordered_map<std::string, uint32_t> lookup;
+    lookup.reserve(previous.size());
+    std::string key;
+    for (uint32_t i = 0; i < previous.size(); ++i)
+    {
+        OutreachKey(key, previous[i].first_name, previous[i].last_name, previous[i].occurrence);
+        lookup.emplace(key, i);
+    }
+
+    // Probe with the roll, in roll order
+    const std::vector<uint32_t> occurrences{ NameOccurrences(classRoll) };
+    std::vector<char> matched(previous.size(), 0);
+    for (std::size_t i = 0; i < classRoll.size(); ++i)
+    {
+        const person& member{ classRoll[i] };
+        OutreachKey(key, member.first_name, member.last_name, occurrences[i]);
+
+        eya::OutreachAction before{ eya::OutreachAction::NONE };
+        const auto found = lookup.find(key);
+        if (found != lookup.end())
+        {
+            matched[found->second] = 1;
+            before = previous[found->second].action;
+        }
+
+        const eya::OutreachAction action{ i < actions.size() ? actions[i] : eya::OutreachAction::NONE };
+        if (action == before)
+            continue;
+
+        eya::OutreachChange::Kind kind{ eya::OutreachChange::Kind::NEW };
+        if (action == eya::OutreachAction::NONE)
+            kind = eya::OutreachChange::Kind::RESOLVED;
+        else if (before != eya::OutreachAction::NONE && action > before)
+            kind = eya::OutreachChange::Kind::ESCALATED;
+        delta.push_back({ kind, member.first_name, member.last_name, member.member_type, before, action,
+            member.attendance_list.empty() ? 99 : member.attendance_list.back().weeks_absent });
+    }
+
+    // Whoever is left has left the roll
+    for (std::size_t i = 0; i < previous.size(); ++i)
+    {
+        if (!matched[i] && previous[i].action != eya::OutreachAction::NONE)
+        {
+            delta.push_back({ eya::OutreachChange::Kind::RESOLVED, previous[i].first_name, previous[i].last_name, person::MemberType::NA,
+                previous[i].action, eya::OutreachAction::NONE, 99 });
+        }
+    }
+
+    ProfileAddRows(classRoll.size() + previous.size());
+}
+
+namespace
+{
+    // The scoring behind both ScoreAtRisk, sinceFirstSeen(i) is how many Sundays member i's last one comes after the first they were
+    //  seen present or visiting, only asked for candidates
+    template <class SinceFirstSeen>
+    void ScoreAtRiskWith(const std::vector<person>& classRoll, const eya::Analytics& analytics, SinceFirstSeen&& sinceFirstSeen, std::vector<float>& scores,
+        std::vector<int32_t>& weeksSinceSeen)
+    {
+        constexpr float streakWeight{ 0.5f }, rateWeight{ 0.2f }, newWeight{ 0.2f }, typeWeight{ 0.1f };
+        constexpr int32_t peakWeeks{ 6 }, lostWeeks{ 26 };
+        constexpr float typeRisk[] = { 0.75f, 0.5f, 0.25f, 1.0f }; // na, member, leader, visitor
+
+        scores.assign(classRoll.size(), -1.0f);
+        weeksSinceSeen.assign(classRoll.size(), 0);
+        for (std::size_t i = 0; i < classRoll.size(); ++i)
+        {
+            const auto& attendanceList = classRoll[i].attendance_list;
+            if (attendanceList.empty())
+                continue;
+            const int32_t weeksAbsent{ attendanceList.back().weeks_absent };
+            if (weeksAbsent < 1 || weeksAbsent >= lostWeeks)
+                continue;
+
+            weeksSinceSeen[i] = sinceFirstSeen(i);
+
+            const int32_t percent{ i < analytics.rates.size() ? analytics.rates[i].percent : -1 };
+            const float rate{ percent < 0 ? 0.5f : percent / 100.0f };
+            const float streak{ weeksAbsent <= peakWeeks ? static_cast<float>(weeksAbsent) / peakWeeks
+                : static_cast<float>(lostWeeks - weeksAbsent) / (lostWeeks - peakWeeks) };
+            const float recent{ 1.0f - std::min(weeksSinceSeen[i], 52) / 52.0f };
+            scores[i] = streakWeight * streak + rateWeight * (1.0f - rate) + newWeight * recent +
+                typeWeight * typeRisk[static_cast<std::size_t>(classRoll[i].member_type) & 3];
+        }
+    }
+}
+
+// Everyone's at-risk score, -1 for anyone who isn't a candidate (there last Sunday, or gone half a year or more)
+//  A weighted sum of four parts, each 0-1: the current streak, peaking at 6 weeks and fading out by 26 when they are
+//  more lost than at risk, a low attendance rate, having started coming within the last year, and member type
+//  with visitors the most likely to drift
+void ScoreAtRisk(const std::vector<person>& classRoll, const eya::Analytics& analytics, std::vector<float>& scores, std::vector<int32_t>& weeksSinceSeen)
+{
+    ScoreAtRiskWith(classRoll, analytics, [&](std::size_t i)
+        {
+            // Only as far as the first time they came
+            const auto& attendanceList = classRoll[i].attendance_list;
+            std::size_t firstSeen{ 0 };
+            while (firstSeen < attendanceList.size() && attendanceList[firstSeen].type != person::AttendanceType::PRESENT &&
+                attendanceList[firstSeen].type != person::AttendanceType::VISITING)
+            {
+                ++firstSeen;
+            }
+            return static_cast<int32_t>(attendanceList.size() - 1 - std::min(firstSeen, attendanceList.size() - 1));
+        }, scores, weeksSinceSeen);
+}
+
+// The same from a compressed roll, where each member's attendance_list holds only the last Sunday and the rest is in history
+void ScoreAtRisk(const std::vector<person>& classRoll, const AttendanceHistory& history, const eya::Analytics& analytics, std::vector<float>& scores,
+    std::vector<int32_t>& weeksSinceSeen)
+{
+    ScoreAtRiskWith(classRoll, analytics, [&](std::size_t i)
+        {
+            uint32_t columns{ 0 }, firstSeen{ std::numeric_limits<uint32_t>::max() };
+            history.ForEach(static_cast<uint32_t>(i), [&](person::AttendanceType type)
+                {
+                    if (firstSeen > columns && (type == person::AttendanceType::PRESENT || type == person::AttendanceType::VISITING))
+                        firstSeen = columns;
+                    ++columns;
+                });
+            return static_cast<int32_t>(columns - 1 - std::min(firstSeen, columns - 1));
+        }, scores, weeksSinceSeen);
+}
+
+// The k highest scores, highest first with ties in roll order, a partial selection rather than a sort of the whole roll
+void SelectAtRisk(const std::vector<person>& classRoll, const std::vector<float>& scores, const std::vector<int32_t>& weeksSinceSeen, std::size_t k, eya::AtRiskRanking& ranking)
+{
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = 0; i < scores.size(); ++i)
+    {
+        if (scores[i] >= 0)
+            candidates.push_back(i);
+    }
+
+    const auto higher = [&](uint32_t a, uint32_t b) { return scores[a] != scores[b] ? scores[a] > scores[b] : a < b; };
+    k = std::min(k, candidates.size());
+    std::nth_element(candidates.begin(), candidates.begin() + k, candidates.end(), higher);
+    std::sort(candidates.begin(), candidates.begin() + k, higher);
+
+    ranking.clear();
+    ranking.reserve(k);
+    for (std::size_t i = 0; i < k; ++i)
+    {
+        const uint32_t member{ candidates[i] };
+        ranking.push_back({ member, scores[member], classRoll[member].attendance_list.back().weeks_absent, weeksSinceSeen[member] });
+    }
+}
+
+namespace
+{
+    // The writing behind both OutputDataToReportFile, writeWeeks(out, i) writes member i's weeks absent, a cell each
+    template <class WriteWeeks>
+    bool WriteReportRows(std::ostream& outFile, const std::vector<std::string>& headers, const std::vector<person>& classRoll, const std::vector<eya::OutreachAction>& actions,
+        WriteWeeks&& writeWeeks)
+    {
+        if (!outFile.good())
+        {
+            return false;
+        }
+        const auto startPos = outFile.tellp();
+
+        // Output the headers
+        for (uint32_t i = 0; i < headers.size(); ++i)
+        {
+            outFile << headers[i] << ",";
+
+            if (i == 1)
+                outFile << "Member Type,Action,";
+
+        }
+
+        outFile << "\n";
+
+        // For each member
+        const auto writeRows = [&](std::ostream& out, std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    const person& member{ classRoll[i] };
+
+                    // Output first/last name
+                    out << CsvName{ member.first_name } << ",";
+                    out << CsvName{ member.last_name } << ",";
+                    out << eya::ToString(member.member_type) << ",";
+
+                    // Based on the LAST week's absent count output a special action
+                    out << eya::ToString(i < actions.size() ? actions[i] : eya::OutreachAction::NONE) << ",";
+
+                    // Output all the absent weeks, this should match the number of actual weeks..
+                    writeWeeks(out, i);
+
+                    out << "\n";
+                }
+            };
+
+        // Formatting is most of the work, so large rolls are formatted a piece at a time across the scheduler and written in order
+        const std::size_t grain{ MembersPerTask(headers.size()) };
+        if (classRoll.size() <= grain || TaskScheduler::Shared().Size() < 2)
+        {
+            writeRows(outFile, 0, classRoll.size());
+        }
+        else
+        {
+            std::vector<std::string> pieces((classRoll.size() + grain - 1) / grain);
+            ParallelFor(0, classRoll.size(), grain, [&](std::size_t begin, std::size_t end)
+                {
+                    std::ostringstream out;
+                    writeRows(out, begin, end);
+                    pieces[begin / grain] = std::move(out).str();
+                });
+            for (const auto& piece : pieces)
+                outFile << piece;
+        }
+
+        ProfileAddRows(classRoll.size());
+        if (startPos != std::streampos(-1))
+            ProfileAddBytesWritten(static_cast<uint64_t>(outFile.tellp() - startPos));
+
+        return outFile.good();
+    }
+}
+
+// Create an overall report file, this is basically a better version of the planning center output
+bool OutputDataToReportFile(std::ostream& outFile, const std::vector<std::string>& headers, const std::vector<person>& classRoll, const std::vector<eya::OutreachAction>& actions)
+{
+    return WriteReportRows(outFile, headers, classRoll, actions, [&](std::ostream& out, std::size_t i)
+        {
+            for (auto& Attendance : classRoll[i].attendance_list)
+            {
+                out << Attendance.weeks_absent << ",";
+            }
+        });
+}
+
+// The same from a compressed roll, weeks absent are worked out again from history while each member's row is written
+bool OutputDataToReportFile(std::ostream& outFile, const std::vector<std::string>& headers, const std::vector<person>& classRoll, const AttendanceHistory& history,
+    const std::vector<eya::OutreachAction>& actions)
+{
+    return WriteReportRows(outFile, headers, classRoll, actions, [&](std::ostream& out, std::size_t i)
+        {
+            AbsenceCounter counter{ false, 0 };
+            history.ForEach(static_cast<uint32_t>(i), [&](person::AttendanceType type) { out << counter.Next(type) << ","; });
+        });
+}
+
+// Create an output report file, this is a brief report that tells who needs to be reached out to based on number of absences
+bool OutputDataToOutreachFile(std::ostream& outFile, const std::vector<person>& classRoll, const std::vector<eya::OutreachEntry>& outreach)
+{
+    if (!outFile.good())
+    {
+        return false;
+    }
+    const auto startPos = outFile.tellp();
+
+    // Output the headers
+    outFile << "First Name,Last Name,Member Type,Text,Post Card,Phone Call,Visit" << std::endl;
+
+    // For each member that needs reaching out to
+    for (const auto& entry : outreach)
+    {
+        const person& member{ classRoll[entry.member] };
+
+        // Output first/last name
+        outFile << CsvName{ member.first_name } << ",";
+        outFile << CsvName{ member.last_name } << ",";
+        outFile << eya::ToString(member.member_type) << ",";
+
+        // Put the action in its own column
+        switch (entry.action)
+        {
+        case eya::OutreachAction::TEXT:
+            outFile << "Text,,,";
+            break;
+        case eya::OutreachAction::POST_CARD:
+            outFile << ",Post Card,,";
+            break;
+        case eya::OutreachAction::PHONE_CALL:
+            outFile << ",,Phone Call,";
+            break;
+        case eya::OutreachAction::VISIT:
+            outFile << ",,,Visit";
+            break;
+        default:
+            outFile << ",,,";
+        };
+
+        outFile << std::endl;
+    }
+
+    ProfileAddRows(outreach.size());
+    if (startPos != std::streampos(-1))
+        ProfileAddBytesWritten(static_cast<uint64_t>(outFile.tellp() - startPos));
+
+    return outFile.good();
+}
+
+// Create an analytics report file, headcounts for each Sunday then each member's rate next to the export's percent
+bool OutputDataToAnalyticsFile(std::ostream& outFile, const std::vector<std::string>& headers, const std::vector<person>& classRoll, const eya::Analytics& analytics)
+{
+    if (!outFile.good())
+    {
+        return false;
+    }
+    const auto startPos = outFile.tellp();
+    const auto flags = outFile.flags();
+    const auto precision = outFile.precision();
+    outFile << std::fixed << std::setprecision(1);
+
+    // One row per Sunday, headers are "first name", "last name", then the Sundays
+    outFile << "Sunday,Headcount,Members,Leaders,Visitors,Absent,Not Taken,Off Roll,4 Week Average,12 Week Average\n";
+    for (std::size_t c = 0; c < analytics.sundays.size() && c + 2 < headers.size(); ++c)
+    {
+        const eya::SundayCounts& sunday{ analytics.sundays[c] };
+        outFile << headers[c + 2] << "," << sunday.Headcount() << "," << sunday.members << "," << sunday.leaders << "," << sunday.visitors << ","
+            << sunday.absent << "," << sunday.not_taken << "," << sunday.off_roll << "," << sunday.average_4 << "," << sunday.average_12 << "\n";
+    }
+
+    // Then one per member, Matches is left empty when either side has nothing to compare
+    outFile << "\nFirst Name,Last Name,Member Type,Attended,Possible,Rate,Percent,Matches\n";
+    for (std::size_t i = 0; i < classRoll.size() && i < analytics.rates.size(); ++i)
+    {
+        const person& member{ classRoll[i] };
+        const eya::MemberRate& rate{ analytics.rates[i] };
+        outFile << CsvName{ member.first_name } << "," << CsvName{ member.last_name } << "," << eya::ToString(member.member_type) << ","
+            << rate.attended << "," << rate.possible << ",";
+        if (rate.percent >= 0)
+            outFile << rate.percent;
+        outFile << ",";
+        if (member.percent >= 0)
+            outFile << member.percent;
+        outFile << ",";
+        if (rate.percent >= 0 && member.percent >= 0)
+            outFile << (std::abs(member.percent - rate.percent) > 1 ? "No" : "Yes");
+        outFile << "\n";
+    }
+
+    outFile.flags(flags);
+    outFile.precision(precision);
+
+    ProfileAddRows(analytics.sundays.size() + classRoll.size());
+    if (startPos != std::streampos(-1))
+        ProfileAddBytesWritten(static_cast<uint64_t>(outFile.tellp() - startPos));
+
+    return outFile.good();
+}
+
+// Create a cohort report file, retention by months since first seen, then 3, 6 and 12 months against the same cohort a year earlier
+bool OutputDataToCohortFile(std::ostream& outFile, const eya::Cohorts& cohorts)
+{
+    if (!outFile.good())
+    {
+        return false;
+    }
+    const auto startPos = outFile.tellp();
+    const auto flags = outFile.flags();
+    const auto precision = outFile.precision();
+    outFile << std::fixed << std::setprecision(1);
+
+    // Percent of each cohort still coming, left empty past the end of the export
+    const std::size_t months{ cohorts.months.size() };
+    outFile << "Cohort,Size";
+    for (std::size_t offset = 0; offset < months; ++offset)
+        outFile << ",Month " << offset;
+    outFile << "\n";
+    for (std::size_t cohort = 0; cohort < months; ++cohort)
+    {
+        outFile << cohorts.months[cohort] << "," << cohorts.sizes[cohort];
+        for (std::size_t offset = 0; offset < months; ++offset)
+        {
+            outFile << ",";
+            if (cohort + offset < months && cohorts.sizes[cohort] > 0)
+                outFile << 100.0 * cohorts.Retention(cohort, offset);
+        }
+        outFile << "\n";
+    }
+
+    // The headline offsets, and the change in points from the cohort that started twelve months before
+    constexpr std::size_t offsets[] = { 3, 6, 12 };
+    const auto known = [&](std::size_t cohort, std::size_t offset) { return cohorts.sizes[cohort] > 0 && cohort + offset < months; };
+    outFile << "\nCohort,Size,3 Months,6 Months,12 Months,3 Months Change,6 Months Change,12 Months Change\n";
+    for (std::size_t cohort = 0; cohort < months; ++cohort)
+    {
+        outFile << cohorts.months[cohort] << "," << cohorts.sizes[cohort];
+        for (std::size_t offset : offsets)
+        {
+            outFile << ",";
+            if (known(cohort, offset))
+                outFile << 100.0 * cohorts.Retention(cohort, offset);
+        }
+        for (std::size_t offset : offsets)
+        {
+            outFile << ",";
+            if (cohort >= 12 && known(cohort, offset) && known(cohort - 12, offset))
+                outFile << 100.0 * (cohorts.Retention(cohort, offset) - cohorts.Retention(cohort - 12, offset));
+        }
+        outFile << "\n";
+    }
+
+    outFile.flags(flags);
+    outFile.precision(precision);
+
+    ProfileAddRows(2 * months);
+    if (startPos != std::streampos(-1))
+        ProfileAddBytesWritten(static_cast<uint64_t>(outFile.tellp() - startPos));
+
+    return outFile.good();
+}
+
+// Create a ranked outreach file, the at-risk ranking with what the rules say to do about each of them
+bool OutputDataToAtRiskFile(std::ostream& outFile, const std::vector<person>& classRoll, const std::vector<eya::OutreachAction>& actions, const eya::AtRiskRanking& ranking)
+{
+    if (!outFile.good())
+    {
+        return false;
+    }
+    const auto startPos = outFile.tellp();
+    const auto flags = outFile.flags();
+    const auto precision = outFile.precision();
+    outFile << std::fixed << std::setprecision(3);
+
+    outFile << "Rank,First Name,Last Name,Member Type,Weeks Absent,Weeks Since First Seen,Action,Score\n";
+    for (std::size_t rank = 0; rank < ranking.size(); ++rank)
+    {
+        const eya::AtRiskEntry& entry{ ranking[rank] };
+        const person& member{ classRoll[entry.member] };
+        outFile << rank + 1 << "," << CsvName{ member.first_name } << "," << CsvName{ member.last_name } << "," << eya::ToString(member.member_type) << ","
+            << entry.weeks_absent << "," << entry.weeks_since_seen << ","
+            << eya::ToString(entry.member < actions.size() ? actions[entry.member] : eya::OutreachAction::NONE) << "," << entry.score << "\n";
+    }
+
+    outFile.flags(flags);
+    outFile.precision(precision);
+
+    ProfileAddRows(ranking.size());
+    if (startPos != std::streampos(-1))
+        ProfileAddBytesWritten(static_cast<uint64_t>(outFile.tellp() - startPos));
+
+    return outFile.good();
+}
+
+// Create an outreach state file, everyone on this run's outreach list with their action, for the next run to diff against
+bool OutputDataToOutreachStateFile(std::ostream& outFile, const std::vector<person>& classRoll, const std::vector<eya::OutreachEntry>& outreach)
+{
+    if (!outFile.good())
+    {
+        return false;
+    }
+    const auto startPos = outFile.tellp();
+
+    const std::vector<uint32_t> occurrences{ NameOccurrences(classRoll) };
+    outFile << outreachStateHeader << "\n";
+    for (const auto& entry : outreach)
+    {
+        const person& member{ classRoll[entry.member] };
+        outFile << CsvName{ member.first_name } << "," << CsvName{ member.last_name } << "," << occurrences[entry.member] << "," << eya::ToString(entry.action) << ","
+            << entry.weeks_absent << "\n";
+    }
+
+    ProfileAddRows(outreach.size());
+    if (startPos != std::streampos(-1))
+        ProfileAddBytesWritten(static_cast<uint64_t>(outFile.tellp() - startPos));
+
+    return outFile.good();
+}
+
+// Create an outreach delta file, only the people whose outreach changed since the previous run
+bool OutputDataToOutreachDeltaFile(std::ostream& outFile, const eya::OutreachDelta& delta)
+{
+    if (!outFile.good())
+    {
+        return false;
+    }
+    const auto startPos = outFile.tellp();
+
+    outFile << "Change,First Name,Last Name,Member Type,Previous Action,Action,Weeks Absent\n";
+    for (const auto& change : delta)
+    {
+        outFile << eya::ToString(change.kind) << "," << CsvName{ change.first_name } << "," << CsvName{ change.last_name } << ","
+            << eya::ToString(change.member_type) << "," << eya::ToString(change.previous) << "," << eya::ToString(change.action) << ",";
+        if (change.weeks_absent < 99)
+            outFile << change.weeks_absent;
+        outFile << "\n";
+    }
+
+    ProfileAddRows(delta.size());
+    if (startPos != std::streampos(-1))
+        ProfileAddBytesWritten(static_cast<uint64_t>(outFile.tellp() - startPos));
+
+    return outFile.good();
+}
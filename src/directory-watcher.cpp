@@ -0,0 +1,191 @@
+// directory-watcher.cpp : New and rewritten exports in a drop directory, inotify with a polling fallback
+//
+
+#include "directory-watcher.h"
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // Only exports are interesting, compressed ones too, the pipeline rejects anything else anyway
+    bool IsExport(const std::filesystem::path& path)
+    {
+        if (path.extension() == ".gz" || path.extension() == ".zst")
+            return path.stem().extension() == ".csv";
+        return path.extension() == ".csv";
+    }
+}
+
+DirectoryWatcher::DirectoryWatcher(const std::string& directory, std::chrono::milliseconds settle)
+    : directory(directory), settle(settle)
+{
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+#ifdef __linux__
+    if (inotifyFd >= 0)
+        close(inotifyFd);
+#endif
+}
+
+// Start watching, files already in the directory count as new, returns false with a reason when the directory can't be read
+bool DirectoryWatcher::Open(std::string& reason)
+{
+    std::error_code ec;
+    if (!std::filesystem::is_directory(directory, ec))
+    {
+        reason = "Not a directory: " + directory.string();
+        return false;
+    }
+
+#ifdef __linux__
+    // Writers that copy in place end with IN_CLOSE_WRITE, ones that write elsewhere and rename end with IN_MOVED_TO
+    //  IN_MODIFY keeps pushing the settle time back while a slow copy is still going
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd >= 0 && inotify_add_watch(inotifyFd, directory.c_str(), IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        // Out of watches (fs.inotify.max_user_watches) or a filesystem without inotify, scan instead
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+#endif
+
+    // Whatever is already waiting, scanned after the watch is added so nothing can land in between unseen
+    Scan();
+    return true;
+}
+
+// Wait up to timeout for changes, then append the path of every file that has settled
+void DirectoryWatcher::Poll(std::chrono::milliseconds timeout, std::vector<std::string>& ready)
+{
+    if (UsingInotify())
+    {
+        ReadEvents(timeout);
+    }
+    else
+    {
+        std::this_thread::sleep_for(timeout);
+        Scan();
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = pending.begin(); it != pending.end();)
+    {
+        if (now - it->second.last_change < settle)
+        {
+            ++it;
+            continue;
+        }
+
+        // Quiet for long enough, make sure it really is the same file we last saw
+        std::error_code ec;
+        FileState state;
+        state.size = std::filesystem::file_size(it->first, ec);
+        if (!ec)
+            state.modified = std::filesystem::last_write_time(it->first, ec);
+
+        if (ec)
+        {
+            it = pending.erase(it);
+        }
+        else if (state != it->second.state)
+        {
+            it->second = { state, now };
+            ++it;
+        }
+        else
+        {
+            handedOut[it->first] = state;
+            ready.push_back(it->first);
+            it = pending.erase(it);
+        }
+    }
+}
+
+// Look at every file in the directory, used at startup, when polling, and when inotify dropped events
+void DirectoryWatcher::Scan()
+{
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+    {
+        Touch(it->path());
+    }
+}
+
+// Something happened to this file, start (or restart) its settle time if it differs from what we last saw
+void DirectoryWatcher::Touch(const std::filesystem::path& path)
+{
+    if (!IsExport(path))
+        return;
+
+    const std::string key{ path.string() };
+    std::error_code ec;
+    FileState state;
+    if (std::filesystem::is_regular_file(path, ec))
+    {
+        state.size = std::filesystem::file_size(path, ec);
+        if (!ec)
+            state.modified = std::filesystem::last_write_time(path, ec);
+    }
+    else
+    {
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+    }
+
+    // Deleted or renamed away before it settled
+    if (ec)
+    {
+        pending.erase(key);
+        return;
+    }
+
+    // Already handed out and unchanged since
+    auto done = handedOut.find(key);
+    if (done != handedOut.end() && done->second == state)
+        return;
+
+    auto [entry, added] = pending.try_emplace(key);
+    if (added || entry->second.state != state)
+        entry->second = { state, std::chrono::steady_clock::now() };
+}
+
+// Wait for inotify events and feed every file they name through Touch
+void DirectoryWatcher::ReadEvents(std::chrono::milliseconds timeout)
+{
+#ifdef __linux__
+    pollfd fds{ inotifyFd, POLLIN, 0 };
+    if (poll(&fds, 1, static_cast<int>(timeout.count())) <= 0)
+        return; // timed out, or interrupted by a signal
+
+    alignas(inotify_event) char buffer[64 * 1024];
+    bool overflowed{ false };
+    for (;;)
+    {
+        const ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break; // drained (EAGAIN)
+
+        for (char* p = buffer; p < buffer + length;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(p);
+            if (event->mask & IN_Q_OVERFLOW)
+                overflowed = true;
+            else if (event->len > 0)
+                Touch(directory / event->name);
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    // The kernel queue filled up and events were lost, find out what changed the slow way
+    if (overflowed)
+        Scan();
+#else
+    std::this_thread::sleep_for(timeout);
+#endif
+}
@@ -1,556 +1,412 @@
 // eya-attendance.cpp : This file contains the 'main' function. Program execution begins and ends there.
 //
 
-#include "csv.h"
-#include "person.h"
-#include <iostream>
+#include "eya-attendance.h"
+#include "attendance.h"
+#include "profiler.h"
+#include "query-server.h"
+#include "shutdown.h"
+#include "watch-mode.h"
+#include <charconv>
+#include <chrono>
 #include <fstream>
-#include <sstream>
+#include <iostream>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <string>
-#include <ctime>
-#include <filesystem>
-#include <unordered_set>
 
-// Validates an input string is in a valid date format and is a Sunday
-bool ValidDateFormat(const std::string& date)
+// A way to print a message and require pressing enter to continue
+void PrintMessageAndWait(const std::string& msg)
 {
-    int d, m, y;
-    std::istringstream is(date);
-    char delimiter;
-    if (is >> m >> delimiter >> d >> delimiter >> y) {
-        struct tm t = { 0 };
-        t.tm_mday = d;
-        t.tm_mon = m - 1;
-        t.tm_year = y - 1900;
-        t.tm_isdst = -1;
-
-        // normalize:
-        time_t when = mktime(&t);
-        const struct tm* norm = localtime(&when);
-        // the actual date would be:
-        // m = norm->tm_mon + 1;
-        // d = norm->tm_mday;
-        // y = norm->tm_year;
-        // e.g. 29/02/2013 would become 01/03/2013
-
-        // validate (is the normalized date still the same?):
-        if (norm->tm_mday == d &&
-            norm->tm_mon == m - 1 &&
-            norm->tm_year == y - 1900 &&
-            norm->tm_wday == 0) // Sunday
-        {
-            // Valid date and Sunday
-            return true;
-        }
-    }
-    
-    // Invalid date or not a Sunday
-    return false;
+    // Don't close the window immediately
+    std::cout << msg << std::endl << std::endl;
+    std::cout << "Press Enter to continue...";
+
+    // Use std::getline to wait for the user to press Enter
+    std::string dummy;
+    std::getline(std::cin, dummy);
 }
 
-// Validates an input file path is a valid file and has a .csv extension
-bool IsValidCSV(const std::string& filePath)
+// Print what the library had to say, in the order it was said
+void PrintDiagnostics(const eya::Diagnostics& diagnostics)
 {
-    // Check if the file exists
-    if (!std::filesystem::exists(filePath)) {
-        std::cout << "File does not exist: " << filePath << std::endl;
-        return false;
-    }
-
-    // Check if the file has a .csv extension
-    if (std::filesystem::path(filePath).extension() != ".csv") {
-        std::cout << "File is not a CSV file: " << filePath << std::endl;
-        return false;
+    for (const auto& diagnostic : diagnostics)
+    {
+        std::cout << diagnostic.message << std::endl;
     }
-
-    // Additional checks specific to CSV format can be added if necessary
-
-    // If both checks pass, consider it a valid CSV file
-    return true;
 }
 
-// From an input file path, scrub the file name for the date
-bool ScrubDateFromFileName(const std::string& filePath, std::string& date)
+// Options that can be given on the command line ahead of the export file
+struct CommandLineOptions
 {
-    // Tokenize the header row
-    std::istringstream split(std::filesystem::path(filePath).stem().string());
-    std::vector<std::string> tokens;
-
-    // Push each field into the headers array
-    for (std::string each; std::getline(split, each, '-'); tokens.push_back(each));
-
-    // The file name convention (as of 1/15/24) is "attendance-report-young-adults-yyyy-mm-dd-yyyy-mm-dd.csv"
-    if (tokens.size() != 10 || (tokens[0] != "attendance" || tokens[1] != "report" || tokens[2] != "young" || tokens[3] != "adults"))
-        return false;
-
-    // We're grabbing the last 3 tokens (the second date) for the date, that should be the last day of the report time (when it's ran)
-    date = tokens[7] + "-" + tokens[8] + "-" + tokens[9];
-
-    return true;
-}
-
-// Retrieve the first row, "header row", from the csv
- bool GetHeaderRow(const std::string& filePath, std::string& headerRow)
+    std::string inputFile{};
+    bool profile{ false };
+    bool perf{ false };
+    std::string traceFile{};
+    WatchOptions watch{};
+    std::string serve{};
+    std::string rulesFile{};
+    std::string previousState{};
+    unsigned readThreads{ 0 };
+    unsigned workers{ 0 };
+    bool pinThreads{ false };
+    std::size_t readBufferMb{ 0 };
+};
+
+// Parse a whole argument as a number
+template <typename T>
+bool ParseNumber(const std::string& arg, T& value)
 {
-    // Open the file for reading
-    std::ifstream inFile;
-    inFile.open(filePath);
-
-    // Get the header row (first row to the newline)
-    if (!inFile.good())
-    {
-        return false;
-    }
-    std::getline(inFile, headerRow, '\n');
-
-    // Close the file
-    inFile.close();
-
-    return true;
+    const auto [end, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+    return ec == std::errc() && end == arg.data() + arg.size();
 }
 
-// Tokenize the header row, assuming comma separation, into a vector of headers
-bool TokenizeHeaderRow(const std::string& headerRow, std::vector<std::string>& headers)
+// Parse the command line, a bare file path (drag-drop) is still all that is required
+bool ParseCommandLine(int argc, char* argv[], CommandLineOptions& options)
 {
-    // Tokenize the header row
-    std::istringstream split(headerRow);
-
-    // Push each field into the headers array
-    for (std::string each; std::getline(split, each, ','); headers.push_back(each));
-
-    // Make sure we have basic data, sizes, and known fields
-    if (!headers.empty() && headers.size() > 3 && headers[0] == "first name" && headers[1] == "last name" && headers[2] == "percent")
+    for (int i = 1; i < argc; ++i)
     {
-        // Erase all the headers we don't care about, keep the name, and Sundays
-        auto erased = std::erase_if(headers, [](std::string s)
-            {
-                if (s == "first name" || s == "last name" || /*s == "percent" ||*/ ValidDateFormat(s))
-                    return false;
-                else
-                    return true;
-            });
-        
-        if (erased > 0)
+        const std::string arg{ argv[i] };
+        if (arg == "--profile")
         {
-            std::cout << "Erased " << erased << " event(s) that were not on Sunday or an invalid date format" << std::endl;
+            options.profile = true;
         }
-
-        // Added a continue in parse_header_line() of csv.h to allow for parsing of CSVs with duplicate headers.
-        //  This seems to work somehow, it prevents throwing the error::duplicated_column_in_header error
-        // 
-        // Erase duplicates in the headers vector by trying to put each header into
-        //  an unordered_set, if the insert fails (do to being duplicate), erase it
-        // This assumes that the FIRST EVENT on a Sunday is Sunday School
-        erased = std::erase_if(headers, [&](std::string s)
-            {
-                static std::unordered_set<std::string> seenWords;
-                return seenWords.insert(s).second == false;
-            });
-
-        if (erased > 0)
+        else if (arg == "--perf")
         {
-            std::cout << "Erased " << erased << " event(s) that were on Sunday, but probably were not Sunday School" << std::endl;
+            // Hardware counters are reported through the profile table
+            options.profile = true;
+            options.perf = true;
         }
-
-        return true;
-    }
-    else
-    {
-        return false;
-    }
-}
-
-// Use the CSVReader class and the headers to create a roll vector containing everyone's attendance
-bool CreateClassRollVector(const std::string& filePath, const std::vector<std::string>& headers, const uint32_t actualNumHeaders, std::vector<person>& classRoll)
-{
-    try
-    {
-        // Create the csv reader with the file's path
-        io::CSVReader<100> in(filePath);
-
-        // Read the header row, this tells the csv parser all our headers .. since we're doing this dynamically we have to have 100 spots
-        in.read_header(io::ignore_extra_column | io::ignore_missing_column,
-            headers[0], headers[1], headers[2], headers[3], headers[4], headers[5], headers[6], headers[7], headers[8], headers[9], headers[10], headers[11], headers[12], headers[13], headers[14], headers[15], headers[16], headers[17], headers[18], headers[19], headers[20], headers[21], headers[22], headers[23], headers[24], headers[25], headers[26], headers[27], headers[28], headers[29], headers[30], headers[31], headers[32], headers[33], headers[34], headers[35], headers[36], headers[37], headers[38], headers[39], headers[40], headers[41], headers[42], headers[43], headers[44], headers[45], headers[46], headers[47], headers[48], headers[49], headers[50], headers[51], headers[52], headers[53], headers[54], headers[55], headers[56], headers[57], headers[58], headers[59], headers[60], headers[61], headers[62], headers[63], headers[64], headers[65], headers[66], headers[67], headers[68], headers[69], headers[70], headers[71], headers[72], headers[73], headers[74], headers[75], headers[76], headers[77], headers[78], headers[79], headers[80], headers[81], headers[82], headers[83], headers[84], headers[85], headers[86], headers[87], headers[88], headers[89], headers[90], headers[91], headers[92], headers[93], headers[94], headers[95], headers[96], headers[97], headers[98], headers[99]
-        );
-
-        std::vector<std::string> data;
-        data.resize(100);
-
-        // While we can read a new row of data from the csv...
-        while (in.read_row(data[0], data[1], data[2], data[3], data[4], data[5], data[6], data[7], data[8], data[9], data[10], data[11], data[12], data[13], data[14], data[15], data[16], data[17], data[18], data[19], data[20], data[21], data[22], data[23], data[24], data[25], data[26], data[27], data[28], data[29], data[30], data[31], data[32], data[33], data[34], data[35], data[36], data[37], data[38], data[39], data[40], data[41], data[42], data[43], data[44], data[45], data[46], data[47], data[48], data[49], data[50], data[51], data[52], data[53], data[54], data[55], data[56], data[57], data[58], data[59], data[60], data[61], data[62], data[63], data[64], data[65], data[66], data[67], data[68], data[69], data[70], data[71], data[72], data[73], data[74], data[75], data[76], data[77], data[78], data[79], data[80], data[81], data[82], data[83], data[84], data[85], data[86], data[87], data[88], data[89], data[90], data[91], data[92], data[93], data[94], data[95], data[96], data[97], data[98], data[99]
-        ))
+        else if (arg == "--trace" && i + 1 < argc)
         {
-            // Create a person and put data within
-            person tmpPerson;
-            tmpPerson.first_name = data[0];
-            tmpPerson.last_name = data[1];
-            //tmpPerson.percent = data[2]; We don't care about percent right now
-
-            // For each day, convert the attendance type into an enumeration that can be used
-            person::MemberType memberType{ person::MemberType::NA };
-            for (uint32_t i = 2; i < actualNumHeaders; ++i)
-            {
-                person::AttendanceType attendanceType{ person::AttendanceType::NA };
-
-                if (data[i] == "membership removed")
-                {
-                    attendanceType = person::AttendanceType::NA;
-                    //memberType = person::MemberType::NA; // Comment out to ensure we always know what they were last (in case they someone was removed)
-                }
-                else if (data[i] == "attendance not taken")
-                {
-                    attendanceType = person::AttendanceType::NOT_TAKEN;
-                }
-                else if (data[i] == "attended as member")
-                {
-                    attendanceType = person::AttendanceType::PRESENT;
-                    memberType = person::MemberType::MEMBER;
-                }
-                else if (data[i] == "attended as leader")
-                {
-                    attendanceType = person::AttendanceType::PRESENT;
-                    memberType = person::MemberType::LEADER;
-                }
-                else if (data[i] == "attended as visitor")
-                {
-                    attendanceType = person::AttendanceType::VISITING;
-                    memberType = person::MemberType::VISITOR;
-                }
-                else if (data[i] == "")
-                {
-                    attendanceType = person::AttendanceType::NOT_PRESENT;
-                }
-
-                tmpPerson.member_type = memberType;
-                tmpPerson.attendance_list.push_back({ headers[i], attendanceType });
-            }
-
-            classRoll.emplace_back(tmpPerson);
+            // A trace is only useful with the stage data, so it implies --profile
+            options.profile = true;
+            options.traceFile = argv[++i];
         }
-    }
-    catch(...)
-    {
-        return false;
-    }
-
-    return true;
-}
-
-// For each person in the roll, iterate over all days and keep a running total of weeks absent, resetting when appropriate
-bool CountAbsentWeeks(std::vector<person>& classRoll)
-{
-    for (auto& member : classRoll)
-    {
-        uint32_t weeksAbsent{ 99 };
-        for (auto& attendance : member.attendance_list)
+        else if (arg == "--watch" && i + 1 < argc)
+        {
+            options.watch.directory = argv[++i];
+        }
+        else if (arg == "--output" && i + 1 < argc)
+        {
+            options.watch.output_directory = argv[++i];
+        }
+        else if (arg == "--workers" && i + 1 < argc)
+        {
+            if (!ParseNumber(argv[++i], options.workers))
+                return false;
+        }
+        else if (arg == "--pin-threads")
+        {
+            options.pinThreads = true;
+        }
+        else if (arg == "--read-threads" && i + 1 < argc)
+        {
+            if (!ParseNumber(argv[++i], options.readThreads) || options.readThreads == 0)
+                return false;
+        }
+        else if (arg == "--read-buffer-mb" && i + 1 < argc)
+        {
+            if (!ParseNumber(argv[++i], options.readBufferMb) || options.readBufferMb == 0)
+                return false;
+        }
+        else if (arg == "--settle" && i + 1 < argc)
+        {
+            if (!ParseNumber(argv[++i], options.watch.settle_ms))
+                return false;
+        }
+        else if (arg == "--serve" && i + 1 < argc)
         {
-            // If they are marked present or visiting reset their absent count and their seen variable
-            if (attendance.type == person::AttendanceType::PRESENT ||
-                attendance.type == person::AttendanceType::VISITING)
-            {
-                if (!member.seen)
-                    member.seen = true;
-                weeksAbsent = 0;
-            }
-            // If they are marked not present and they have been seen, increment weeks absent
-            else if (attendance.type == person::AttendanceType::NOT_PRESENT)
-            {
-                if (member.seen)
-                    weeksAbsent++;
-            }
-            // If they are marked n/a they aren't on the role and weren't there, set their seen to false and weeks absent to 99
-            else if (attendance.type == person::AttendanceType::NA)
-            {
-                member.seen = false;
-                weeksAbsent = 99;
-            }
-            attendance.weeks_absent = weeksAbsent;
-
-            // If they get past week 5 (visit) once, they've "been through the process" and we shouldn't try again
-            if (member.seen && weeksAbsent > 5)
-            {
-                member.been_through_process = true;
-            }
+            options.serve = argv[++i];
+        }
+        else if (arg == "--rules" && i + 1 < argc)
+        {
+            options.rulesFile = argv[++i];
+        }
+        else if (arg == "--previous" && i + 1 < argc)
+        {
+            options.previousState = argv[++i];
+        }
+        else if (arg == "--outreach-only")
+        {
+            options.watch.outreach_only = true;
+        }
+        else if (arg == "--top" && i + 1 < argc)
+        {
+            if (!ParseNumber(argv[++i], options.watch.top_k) || options.watch.top_k == 0)
+                return false;
+        }
+        else if (!arg.starts_with("--") && options.inputFile.empty())
+        {
+            options.inputFile = arg;
+        }
+        else
+        {
+            return false;
         }
     }
-    return true;
-}
 
-// Create an overall report file, this is basically a better version of the planning center output
-bool OutputDataToReportFile(const std::string& date, const std::vector<std::string>& headers, const std::vector<person>& classRoll, const uint32_t actualNumHeaders)
-{
-    // Output to file
-    std::ofstream outFile;
-    if (date.empty())
-    {
-        outFile.open("report.csv");
-    }
-    else
-    {
-        outFile.open("report-" + date + ".csv");
-    }
-    
-    if (!outFile.good())
-    {
+    // The outreach-only roll keeps one Sunday, too little to rank or to answer queries about
+    if (options.watch.outreach_only && (options.watch.top_k != 0 || !options.serve.empty()))
         return false;
-    }
 
-    // Output the headers
-    for (uint32_t i = 0; i < actualNumHeaders; ++i)
-    {
-        outFile << headers[i] << ",";
-
-        if (i == 1)
-            outFile << "Member Type,Action,";
+    // The stage table is printed once at exit, watching would only keep adding every export's stages to it
+    if (options.profile && !options.watch.directory.empty())
+        return false;
 
-    }
+    // Each export in a watched directory would need its own previous state
+    if (!options.previousState.empty() && !options.watch.directory.empty())
+        return false;
 
-    outFile << "\n";
+    // One export, or a directory to watch for them, not both
+    return options.inputFile.empty() != options.watch.directory.empty();
+}
 
-    // For each member
-    for (auto& member : classRoll)
+int main(int argc, char* argv[])
+{
+    // Arguments.. need to pass in a Planning Center attendance export (drag-drop works)
+    CommandLineOptions options;
+    if (!ParseCommandLine(argc, argv, options))
     {
-        // Output first/last name
-        outFile << member.first_name << ",";
-        outFile << member.last_name << ",";
-        
-        // Based on the LAST week's absent count output a special action
-        switch (member.member_type)
-        {
-        case person::MemberType::NA:
-            outFile << "N/A";
-            break;
-        case person::MemberType::MEMBER:
-            outFile << "Member";
-            break;
-        case person::MemberType::LEADER:
-            outFile << "Leader";
-            break;
-        case person::MemberType::VISITOR:
-            outFile << "Visitor";
-            break;
-        default:
-            outFile << "";
-        };
-
-        outFile << ",";
-
-        // Only output to do something if the member has NOT been through the process (haven't made it to week 6 in the past)
-        if (!member.been_through_process)
-        {
-            // Based on the LAST week's absent count output a special action
-            switch (member.attendance_list[member.attendance_list.size() - 1].weeks_absent)
-            {
-            case 2:
-                outFile << "Text";
-                break;
-            case 3:
-                outFile << "Post Card";
-                break;
-            case 4:
-                outFile << "Phone Call";
-                break;
-            case 5:
-                outFile << "Visit";
-                break;
-            default:
-                outFile << "";
-            };
-        }
+        PrintMessageAndWait("Please include a valid Planning Center attendance .csv export (drag-drop onto .exe)\n"
+            "Usage: eya-attendance [--profile] [--perf] [--trace trace.json] <export.csv>\n"
+            "       eya-attendance --watch <directory> [--output <directory>] [--settle ms]\n"
+            "Add --serve <port | unix:/path> to either to answer queries about the latest roll until stopped\n"
+            "Add --rules <rules.txt> to either to use your own outreach ladder, see outreach-rules.txt\n"
+            "Add --top <k> to either to also write the k members most at risk, ranked\n"
+            "Add --outreach-only to either to write just the outreach file, much faster for the weekly run\n"
+            "Add --workers <n> to either to size the worker threads every stage shares (one per CPU), --pin-threads to keep each on its own CPU\n"
+            "Add --read-threads <n> and --read-buffer-mb <n> to either to size the shared read-ahead (2 threads, 64MB)\n"
+            "Add --previous <outreach-state.csv> to a single export to also write only what changed since that run\n"
+            "Exports can also be gzip (.csv.gz) or zstd (.csv.zst) compressed when built with zlib or zstd");
+        return -1;
+    }
 
-        outFile << ",";
+    if (options.profile)
+    {
+        EnableProfiling();
 
-        // Output all the absent weeks, this should match the number of actual weeks..
-        for (auto& Attendance : member.attendance_list)
+        std::string reason;
+        if (options.perf && !EnableHardwareCounters(reason))
         {
-            outFile << Attendance.weeks_absent << ",";
+            std::cout << "Hardware counters unavailable, reporting timings only: " << reason << std::endl;
         }
-
-        outFile << "\n";
     }
 
-    outFile.close();
+    // Every export read shares the read-ahead threads and buffer pool, size them before the first one
+    eya::SetReadLimits(options.readThreads, options.readBufferMb << 20);
 
-    return true;
-}
-
-// Create an output report file, this is a brief report that tells who needs to be reached out to based on number of absences
-bool OutputDataToOutreachFile(const std::string& date, const std::vector<std::string>& headers, const std::vector<person>& classRoll, const uint32_t actualNumHeaders)
-{
-    // Output to file
-    std::ofstream outFile;
-    if (date.empty())
+    // Stage timings, hardware counters and allocations are taken on the thread running the stage, so a profiled run keeps
+    //  every stage on this one
+    if (options.profile && options.workers > 1)
     {
-        outFile.open("outreach.csv");
+        std::cout << "Profiling runs every stage on one thread, ignoring --workers" << std::endl;
     }
-    else
+    eya::SetWorkerThreads(options.profile ? 1 : options.workers, options.pinThreads);
+
+    // Compile the outreach rules once, every export after uses the same table
+    eya::OutreachRules rules;
+    if (!options.rulesFile.empty())
     {
-        outFile.open("outreach-" + date + ".csv");
+        std::string error;
+        if (!rules.LoadFile(options.rulesFile, error))
+        {
+            PrintMessageAndWait("Failed loading the outreach rules\n" + error);
+            return -12;
+        }
+        options.watch.outreach_rules = &rules;
     }
 
-    if (!outFile.good())
+    // Load last run's outreach state before the work, so a bad file fails fast
+    eya::OutreachState previousState;
+    if (!options.previousState.empty())
     {
-        return false;
+        std::ifstream in(options.previousState);
+        std::string error{ "Can't open " + options.previousState };
+        if (!in.good() || !eya::ReadOutreachState(in, previousState, error))
+        {
+            PrintMessageAndWait("Failed loading the previous outreach state\n" + error);
+            return -14;
+        }
     }
 
-    // Output the headers
-    outFile << "First Name,Last Name,Member Type,Text,Post Card,Phone Call,Visit" << std::endl;
-
-    // For each member
-    for (auto& member : classRoll)
+    // Open the query server up front so a port that's in use fails before any work is done
+    std::unique_ptr<QueryServer> server;
+    if (!options.serve.empty())
     {
-        // Only output to do something if the member has NOT been through the process (haven't made it to week 6 in the past)
-        if (member.been_through_process)
-            continue;
-
-        int32_t weeksAbsent{ member.attendance_list[member.attendance_list.size() - 1].weeks_absent };
-
-        // Only do weeks that are between 2 and 5
-        if (weeksAbsent < 2 || weeksAbsent > 5)
-            continue;
-
-        // Output first/last name
-        outFile << member.first_name << ",";
-        outFile << member.last_name << ",";
-
-        // Based on the LAST week's absent count output a special action
-        switch (member.member_type)
-        {
-        case person::MemberType::NA:
-            outFile << "N/A";
-            break;
-        case person::MemberType::MEMBER:
-            outFile << "Member";
-            break;
-        case person::MemberType::LEADER:
-            outFile << "Leader";
-            break;
-        case person::MemberType::VISITOR:
-            outFile << "Visitor";
-            break;
-        default:
-            outFile << "";
-        };
-
-        outFile << ",";
-
-        // Based on the LAST week's absent count output a special action
-        switch (member.attendance_list[member.attendance_list.size() - 1].weeks_absent)
+        server = std::make_unique<QueryServer>();
+        std::string reason;
+        if (!server->Open(options.serve, reason))
         {
-        case 2:
-            outFile << "Text,,,";
-            break;
-        case 3:
-            outFile << ",Post Card,,";
-            break;
-        case 4:
-            outFile << ",,Phone Call,";
-            break;
-        case 5:
-            outFile << ",,,Visit";
-            break;
-        default:
-            outFile << ",,,";
-        };
-
-        outFile << std::endl;
+            PrintMessageAndWait("Failed starting the query server\n" + reason);
+            return -9;
+        }
     }
 
-    outFile.close();
-
-    return true;
-}
-
-// A way to print a message and require pressing enter to continue
-void PrintMessageAndWait(const std::string& msg)
-{
-    // Don't close the window immediately
-    std::cout << msg << std::endl << std::endl;
-    std::cout << "Press Enter to continue...";
-
-    // Use std::getline to wait for the user to press Enter
-    std::string dummy;
-    std::getline(std::cin, dummy);
-}
-
-int main(int argc, char* argv[])
-{
-    // Arguments.. need to pass in a Planning Center attendance export (drag-drop works)
-    if (argc != 2)
+    // Daemon mode, runs until stopped and never waits on the console
+    if (!options.watch.directory.empty())
     {
-        PrintMessageAndWait("Please include a valid Planning Center attendance .csv export (drag-drop onto .exe)");
-        return -1;
+        if (server)
+            server->Start();
+        return RunWatchMode(options.watch, server.get());
     }
 
-    // Basic validation of the input file
-    const std::string inputFileString{ argv[1] };
-    if (!IsValidCSV(inputFileString))
+    // Run the pipeline, the library hands back the roll, the outreach list and anything worth telling the user
+    auto analysis = std::make_shared<eya::AnalysisResult>();
+    eya::AnalysisResult& result{ *analysis };
+    eya::Diagnostics diagnostics;
+
+    // Long exports are held compressed, unless the roll is going to be served to queries
+    eya::Pipeline pipeline{ options.watch.outreach_only ? eya::Pipeline::OUTREACH_ONLY : eya::Pipeline::FULL };
+    if (pipeline == eya::Pipeline::FULL && !server)
+        pipeline = eya::PipelineForExport(options.inputFile);
+    const eya::Status status{ eya::AnalyzeFile(options.inputFile, result, diagnostics, nullptr, &rules, pipeline) };
+    PrintDiagnostics(diagnostics);
+
+    switch (status)
     {
+    case eya::Status::OK:
+        break;
+    case eya::Status::INVALID_INPUT:
         PrintMessageAndWait("Failed doing basic validation on input file\nPlease provide a valid Planning Center attendance .csv export");
         return -2;
+    case eya::Status::NO_HEADER_ROW:
+        PrintMessageAndWait("Failed opening input file to grab header row");
+        return -3;
+    case eya::Status::BAD_HEADER_ROW:
+        PrintMessageAndWait("Failed tokenizing the header row");
+        return -4;
+    case eya::Status::PARSE_FAILED:
+        PrintMessageAndWait("Failed to create a class roll, the export couldn't be read to the end");
+        return -5;
+    case eya::Status::COUNT_FAILED:
+    default:
+        PrintMessageAndWait("Failed to count the number of absent weeks");
+        return -6;
     }
 
-    // Grabbing a date from the file name to use in the output reports
-    std::string fileDate{};
-    if (!ScrubDateFromFileName(inputFileString, fileDate))
+    if (options.perf)
     {
-        std::cout << "Failed extracting date from file name, output reports will have a generic name\nProvide an attendance report in the format \"attendance-report-young-adults-yyyy-mm-dd-yyyy-mm-dd.csv\"\n" << std::endl;
+        eya::Diagnostics perfDiagnostics;
+        MeasureParserStages(options.inputFile, result.headers, perfDiagnostics);
+        PrintDiagnostics(perfDiagnostics);
     }
 
-    // Open the file and grab the header row
-    std::string headerRow{};
-    if (!GetHeaderRow(inputFileString, headerRow))
+    // Output the data to a report csv file
+    if (!options.watch.outreach_only)
     {
-        PrintMessageAndWait("Failed opening input file to grab header row");
-        return -3;
+        ProfileStage stage{ "OutputDataToReportFile" };
+        std::ofstream outFile(eya::ReportFileName(result));
+        if (!eya::WriteReport(outFile, result))
+        {
+            PrintMessageAndWait("Failed creating an output report file");
+            return -7;
+        }
     }
     
-    // Tokenize the header row, do basic validation like only have Sundays, and save the headers in a vector
-    std::vector<std::string> headers;
-    if (!TokenizeHeaderRow(headerRow, headers))
+    // Output the data to an outreach csv file
     {
-        PrintMessageAndWait("Failed tokenizing the header row");
-        return -4;
+        ProfileStage stage{ "OutputDataToOutreachFile" };
+        std::ofstream outFile(eya::OutreachFileName(result));
+        if (!eya::WriteOutreach(outFile, result))
+        {
+            PrintMessageAndWait("Failed creating an output outreach file");
+            return -8;
+        }
     }
 
-    // Save the number of headers we have
-    uint32_t actualNumHeaders{ static_cast<uint32_t>(headers.size()) };
+    // Output this run's outreach state for next week's delta, then the delta against last week's if there was one
+    {
+        ProfileStage stage{ "OutputDataToOutreachStateFile" };
+        std::ofstream outFile(eya::OutreachStateFileName(result));
+        if (!eya::WriteOutreachState(outFile, result))
+        {
+            PrintMessageAndWait("Failed creating an output outreach state file");
+            return -16;
+        }
+    }
+    if (!options.previousState.empty())
+    {
+        eya::OutreachDelta delta;
+        if (!eya::DiffOutreach(previousState, result, delta))
+        {
+            PrintMessageAndWait("Failed working out what changed since the previous outreach");
+            return -15;
+        }
 
-    // Need to resize the headers vector to the number of columns we're going to be looking for
-    headers.resize(100);
+        ProfileStage stage{ "OutputDataToOutreachDeltaFile" };
+        std::ofstream outFile(eya::OutreachDeltaFileName(result));
+        if (!eya::WriteOutreachDelta(outFile, delta))
+        {
+            PrintMessageAndWait("Failed creating an output outreach delta file");
+            return -15;
+        }
+    }
 
-    // Using a csv reader (csv.h) create a class roll with the defined headers
-    std::vector<person> classRoll;
-    if (!CreateClassRollVector(inputFileString, headers, actualNumHeaders, classRoll))
+    // Output the headcounts and rates to an analytics csv file
+    if (!options.watch.outreach_only)
     {
-        PrintMessageAndWait("Failed to create a class roll, most likely due to the CSV parser throwing an exception");
-        return -5;
+        ProfileStage stage{ "OutputDataToAnalyticsFile" };
+        std::ofstream outFile(eya::AnalyticsFileName(result));
+        if (!eya::WriteAnalytics(outFile, result))
+        {
+            PrintMessageAndWait("Failed creating an output analytics file");
+            return -10;
+        }
     }
 
-    // For each member count the number of absent weeks for each given date based on the roll, stores the data in the roll
-    if (!CountAbsentWeeks(classRoll))
+    // Output the retention by cohort to a cohort csv file
+    if (!options.watch.outreach_only)
     {
-        PrintMessageAndWait("Failed to count the number of absent weeks");
-        return -6;
+        ProfileStage stage{ "OutputDataToCohortFile" };
+        std::ofstream outFile(eya::CohortFileName(result));
+        if (!eya::WriteCohorts(outFile, result))
+        {
+            PrintMessageAndWait("Failed creating an output cohort file");
+            return -11;
+        }
     }
 
-    // We need to resize back to the actual number of headers for output
-    // TODO: This is gross
-    headers.resize(actualNumHeaders);
+    // Output the members most at risk to a ranked csv file
+    if (options.watch.top_k != 0)
+    {
+        eya::AtRiskRanking ranking;
+        if (!eya::RankAtRisk(result, options.watch.top_k, ranking))
+        {
+            PrintMessageAndWait("Failed ranking the members most at risk");
+            return -13;
+        }
+
+        ProfileStage stage{ "OutputDataToAtRiskFile" };
+        std::ofstream outFile(eya::AtRiskFileName(result));
+        if (!eya::WriteAtRisk(outFile, result, ranking))
+        {
+            PrintMessageAndWait("Failed creating an output at-risk file");
+            return -13;
+        }
+    }
 
-    // Output the data to a report csv file
-    if (!OutputDataToReportFile(fileDate, headers, classRoll, actualNumHeaders))
+    // Print the stage table, and the trace file if one was asked for
+    if (options.profile)
     {
-        PrintMessageAndWait("Failed creating an output report file");
-        return -7;
+        PrintProfileSummary(std::cout);
+        if (!options.traceFile.empty() && !WriteProfileTrace(options.traceFile))
+        {
+            std::cout << "Failed writing profile trace: " << options.traceFile << std::endl;
+        }
     }
-    
-    // Output the data to an outreach csv file
-    if (!OutputDataToOutreachFile(fileDate, headers, classRoll, actualNumHeaders))
+
+    // Keep the roll loaded and answer queries about it until stopped
+    if (server)
     {
-        PrintMessageAndWait("Failed creating an output outreach file");
-        return -8;
+        InstallStopHandlers();
+        server->Publish(std::make_shared<RollIndex>(std::move(analysis)));
+        server->Start();
+        std::cout << "Reports created successfully, serving queries on " << options.serve << " until Ctrl+C or SIGTERM" << std::endl;
+        while (!StopRequested())
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        return 0;
     }
 
     // Don't close the window immediately
@@ -0,0 +1,450 @@
+// libeya-attendance.cpp : The library entry points in eya-attendance.h, wiring the pipeline stages together
+//
+
+#include "eya-attendance.h"
+#include "attendance.h"
+#include "csv.h"
+#include "profiler.h"
+#include "task-scheduler.h"
+#include "uring-byte-source.h"
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <optional>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // Exports past this many bytes are analyzed compressed, at around 14 bytes a cell that is 18 million cells, which FULL holds in 700MB
+    constexpr std::uintmax_t compressedExportBytes{ std::uintmax_t{ 256 } << 20 };
+
+    // Reads from a descriptor the caller owns
+    //  LineReader takes a short read as the end of the input, so keep reading until the buffer is full (pipes and sockets return less)
+    class FdByteSource : public io::ByteSourceBase
+    {
+    public:
+        explicit FdByteSource(int fd) : fd(fd) {}
+
+        int read(char* buffer, int size) override
+        {
+            int total{ 0 };
+            while (total < size)
+            {
+#ifdef _WIN32
+                const int count = _read(fd, buffer + total, static_cast<unsigned>(size - total));
+#else
+                const auto count = ::read(fd, buffer + total, static_cast<std::size_t>(size - total));
+                if (count < 0 && errno == EINTR)
+                    continue;
+#endif
+                if (count < 0)
+                    throw std::system_error(errno, std::generic_category(), "Failed reading input");
+                if (count == 0)
+                    break;
+                total += static_cast<int>(count);
+            }
+            return total;
+        }
+
+    private:
+        int fd;
+    };
+
+    // Every input goes through here once the line reader can be opened, open() constructs it in place
+    template <typename Open>
+    eya::Status Analyze(Open&& open, const std::string& name, eya::AnalysisResult& result, eya::Diagnostics& diagnostics, eya::AnalysisCache* cache, const eya::OutreachRules* rules,
+        eya::Pipeline pipeline)
+    {
+        result = eya::AnalysisResult{};
+        result.pipeline = pipeline;
+
+        // Grabbing a date from the file name to use in the output reports
+        if (!ScrubDateFromFileName(name, result.date))
+        {
+            diagnostics.push_back({ eya::Diagnostic::Severity::INFO, "Failed extracting date from file name, output reports will have a generic name\n"
+                "Provide an attendance report in the format \"attendance-report-young-adults-yyyy-mm-dd-yyyy-mm-dd.csv\"" });
+        }
+
+        // Open the input and grab the header row
+        std::optional<io::LineReader> in;
+        std::string headerRow{};
+        {
+            ProfileStage stage{ "GetHeaderRow" };
+            try
+            {
+                open(in);
+            }
+            catch (std::exception& err)
+            {
+                diagnostics.push_back({ eya::Diagnostic::Severity::ERROR, err.what() });
+                return eya::Status::NO_HEADER_ROW;
+            }
+
+            if (!GetHeaderRow(*in, headerRow))
+                return eya::Status::NO_HEADER_ROW;
+        }
+
+        // Tokenize the header row, do basic validation like only have Sundays, and save the headers in a vector
+        {
+            ProfileStage stage{ "TokenizeHeaderRow" };
+            if (!TokenizeHeaderRow(headerRow, result.headers, diagnostics, cache ? &cache->Sundays() : nullptr))
+                return eya::Status::BAD_HEADER_ROW;
+        }
+
+        // Read the rest of the input into the roll, rows that don't parse are skipped and reported rather than failing the run
+        io::parse_diagnostics rejected;
+        if (pipeline == eya::Pipeline::OUTREACH_ONLY)
+        {
+            // The weekly run, one pass over each row and nothing kept per week
+            ProfileStage stage{ "CreateOutreachRoll" };
+            if (!CreateOutreachRoll(*in, headerRow, result.headers, result.roll, &rejected))
+                return eya::Status::PARSE_FAILED;
+        }
+        else if (pipeline == eya::Pipeline::COMPRESSED)
+        {
+            // Every Sunday straight into the history, weeks absent are counted on the way so CountAbsentWeeks has nothing to do
+            ProfileStage stage{ "CreateCompressedRoll" };
+            if (!CreateCompressedRoll(*in, headerRow, result.headers, result.roll, result.history, &rejected))
+                return eya::Status::PARSE_FAILED;
+        }
+        else
+        {
+            ProfileStage stage{ "CreateClassRollVector" };
+            if (!CreateClassRollVector(*in, headerRow, result.headers, result.roll, &rejected))
+                return eya::Status::PARSE_FAILED;
+        }
+
+        // Done reading, hand the line buffer back to the pool for the next export rather than holding it through the rest
+        in.reset();
+        if (rejected.count() > 0)
+        {
+            std::string message{ "Skipped " + std::to_string(rejected.count()) + " row(s) that didn't parse, nobody on them is in the reports" };
+            for (const auto& diagnostic : rejected.recorded())
+            {
+                message += "\n    line " + std::to_string(diagnostic.file_line) + ", column " + std::to_string(diagnostic.column) + ": " + io::to_string(diagnostic.reason);
+            }
+            if (rejected.dropped() > 0)
+                message += "\n    and " + std::to_string(rejected.dropped()) + " more";
+            diagnostics.push_back({ eya::Diagnostic::Severity::WARNING, message });
+        }
+
+        // For each member count the number of absent weeks for each given date based on the roll, stores the data in the roll
+        if (pipeline == eya::Pipeline::FULL)
+        {
+            ProfileStage stage{ "CountAbsentWeeks" };
+            if (!CountAbsentWeeks(result.roll))
+                return eya::Status::COUNT_FAILED;
+        }
+
+        // Everyone's action this week in one pass over the rules table, both writers use the same column
+        {
+            ProfileStage stage{ "EvaluateOutreach" };
+            static const eya::OutreachRules ladder;
+            EvaluateOutreach(rules ? *rules : ladder, result.roll, result.actions);
+            BuildOutreachList(result.roll, result.actions, result.outreach);
+        }
+
+        // Headcounts and rates, checked against the export's own percent column
+        if (pipeline != eya::Pipeline::OUTREACH_ONLY)
+        {
+            ProfileStage stage{ "ComputeAnalytics" };
+            if (pipeline == eya::Pipeline::COMPRESSED)
+                ComputeAnalytics(result.roll, result.history, result.analytics);
+            else
+                ComputeAnalytics(result.roll, result.analytics);
+            if (result.analytics.percent_mismatches > 0)
+            {
+                diagnostics.push_back({ eya::Diagnostic::Severity::INFO, std::to_string(result.analytics.percent_mismatches) +
+                    " member(s) whose attendance rate is more than a point away from the export's percent, see the analytics report" });
+            }
+        }
+
+        // Retention by the month people were first seen
+        if (pipeline != eya::Pipeline::OUTREACH_ONLY)
+        {
+            ProfileStage stage{ "ComputeCohorts" };
+            if (pipeline == eya::Pipeline::COMPRESSED)
+                ComputeCohorts(result.headers, result.history, result.cohorts);
+            else
+                ComputeCohorts(result.headers, result.roll, result.cohorts);
+        }
+
+        if (cache)
+        {
+            const uint32_t added{ cache->Members().Update(result.roll) };
+            if (added > 0)
+            {
+                diagnostics.push_back({ eya::Diagnostic::Severity::INFO, std::to_string(added) + " member(s) not in any earlier export" });
+            }
+        }
+
+        return eya::Status::OK;
+    }
+}
+
+namespace eya
+{
+    AnalysisCache::AnalysisCache() : sundays(std::make_unique<SundayTable>()), members(std::make_unique<MemberIndex>())
+    {
+    }
+
+    AnalysisCache::~AnalysisCache() = default;
+
+    void SetReadLimits(unsigned threads, std::size_t maxBufferedBytes)
+    {
+        io::read_service::instance().configure(threads, maxBufferedBytes);
+    }
+
+    bool SetWorkerThreads(unsigned workers, bool pinThreads)
+    {
+        return TaskScheduler::Configure({ workers, pinThreads });
+    }
+
+    Pipeline PipelineForExport(const std::string& filePath)
+    {
+        std::error_code ec;
+        std::uintmax_t bytes{ std::filesystem::file_size(filePath, ec) };
+        if (ec)
+            return Pipeline::FULL;
+
+        const std::filesystem::path extension{ std::filesystem::path(filePath).extension() };
+        if (extension == ".gz" || extension == ".zst")
+            bytes *= 10;
+        return bytes > compressedExportBytes ? Pipeline::COMPRESSED : Pipeline::FULL;
+    }
+
+    Status AnalyzeFile(const std::string& filePath, AnalysisResult& result, Diagnostics& diagnostics, AnalysisCache* cache, const OutreachRules* rules, Pipeline pipeline)
+    {
+        // Basic validation of the input file
+        {
+            ProfileStage stage{ "IsValidCSV" };
+            if (!IsValidCSV(filePath, diagnostics))
+                return Status::INVALID_INPUT;
+        }
+
+        // Several block reads in flight through io_uring where it's available, LineReader's own reader everywhere else
+        const auto open = [&](std::optional<io::LineReader>& in)
+            {
+                if (auto source = OpenUringByteSource(filePath))
+                    in.emplace(filePath, std::move(source));
+                else
+                    in.emplace(filePath);
+            };
+        return Analyze(open, filePath, result, diagnostics, cache, rules, pipeline);
+    }
+
+    Status AnalyzeBuffer(const char* data, std::size_t size, const std::string& name, AnalysisResult& result, Diagnostics& diagnostics, AnalysisCache* cache,
+        const OutreachRules* rules, Pipeline pipeline)
+    {
+        return Analyze([&](std::optional<io::LineReader>& in) { in.emplace(name, data, data + size); }, name, result, diagnostics, cache, rules, pipeline);
+    }
+
+    Status AnalyzeFd(int fd, const std::string& name, AnalysisResult& result, Diagnostics& diagnostics, AnalysisCache* cache, const OutreachRules* rules, Pipeline pipeline)
+    {
+        return Analyze([&](std::optional<io::LineReader>& in) { in.emplace(name, std::make_unique<FdByteSource>(fd)); }, name, result, diagnostics, cache, rules, pipeline);
+    }
+
+    bool RankAtRisk(const AnalysisResult& result, std::size_t k, AtRiskRanking& ranking)
+    {
+        // Rates and first seen need every Sunday
+        if (result.pipeline == Pipeline::OUTREACH_ONLY)
+            return false;
+
+        ProfileStage stage{ "RankAtRisk" };
+        try
+        {
+            std::vector<float> scores;
+            std::vector<int32_t> weeksSinceSeen;
+            if (result.pipeline == Pipeline::COMPRESSED)
+                ScoreAtRisk(result.roll, result.history, result.analytics, scores, weeksSinceSeen);
+            else
+                ScoreAtRisk(result.roll, result.analytics, scores, weeksSinceSeen);
+            SelectAtRisk(result.roll, scores, weeksSinceSeen, k, ranking);
+        }
+        catch (std::exception&)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    bool RankAtRisk(const std::vector<const AnalysisResult*>& groups, std::size_t k, std::vector<AtRiskRanking>& rankings)
+    {
+        rankings.assign(groups.size(), {});
+        std::vector<char> ranked(groups.size(), 0);
+        // A task per group, each group is scored and selected on its own
+        ParallelFor(0, groups.size(), 1, [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                    ranked[i] = RankAtRisk(*groups[i], k, rankings[i]);
+            });
+        return std::all_of(ranked.begin(), ranked.end(), [](char each) { return each != 0; });
+    }
+
+    bool ReadOutreachState(std::istream& in, OutreachState& state, std::string& error)
+    {
+        return ReadOutreachStateFile(in, state, error);
+    }
+
+    bool DiffOutreach(const OutreachState& previous, const AnalysisResult& result, OutreachDelta& delta)
+    {
+        ProfileStage stage{ "DiffOutreach" };
+        try
+        {
+            DiffOutreach(previous, result.roll, result.actions, delta);
+        }
+        catch (std::exception&)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    bool WriteReport(std::ostream& out, const AnalysisResult& result)
+    {
+        if (result.pipeline == Pipeline::COMPRESSED)
+            return OutputDataToReportFile(out, result.headers, result.roll, result.history, result.actions);
+        return result.pipeline == Pipeline::FULL && OutputDataToReportFile(out, result.headers, result.roll, result.actions);
+    }
+
+    bool WriteOutreach(std::ostream& out, const AnalysisResult& result)
+    {
+        return OutputDataToOutreachFile(out, result.roll, result.outreach);
+    }
+
+    bool WriteAnalytics(std::ostream& out, const AnalysisResult& result)
+    {
+        return result.pipeline != Pipeline::OUTREACH_ONLY && OutputDataToAnalyticsFile(out, result.headers, result.roll, result.analytics);
+    }
+
+    bool WriteCohorts(std::ostream& out, const AnalysisResult& result)
+    {
+        return result.pipeline != Pipeline::OUTREACH_ONLY && OutputDataToCohortFile(out, result.cohorts);
+    }
+
+    bool WriteAtRisk(std::ostream& out, const AnalysisResult& result, const AtRiskRanking& ranking)
+    {
+        return result.pipeline != Pipeline::OUTREACH_ONLY && OutputDataToAtRiskFile(out, result.roll, result.actions, ranking);
+    }
+
+    bool WriteOutreachState(std::ostream& out, const AnalysisResult& result)
+    {
+        return OutputDataToOutreachStateFile(out, result.roll, result.outreach);
+    }
+
+    bool WriteOutreachDelta(std::ostream& out, const OutreachDelta& delta)
+    {
+        return OutputDataToOutreachDeltaFile(out, delta);
+    }
+
+    std::string ReportFileName(const AnalysisResult& result)
+    {
+        return result.date.empty() ? "report.csv" : "report-" + result.date + ".csv";
+    }
+
+    std::string OutreachFileName(const AnalysisResult& result)
+    {
+        return result.date.empty() ? "outreach.csv" : "outreach-" + result.date + ".csv";
+    }
+
+    std::string AnalyticsFileName(const AnalysisResult& result)
+    {
+        return result.date.empty() ? "analytics.csv" : "analytics-" + result.date + ".csv";
+    }
+
+    std::string CohortFileName(const AnalysisResult& result)
+    {
+        return result.date.empty() ? "cohorts.csv" : "cohorts-" + result.date + ".csv";
+    }
+
+    std::string AtRiskFileName(const AnalysisResult& result)
+    {
+        return result.date.empty() ? "at-risk.csv" : "at-risk-" + result.date + ".csv";
+    }
+
+    std::string OutreachStateFileName(const AnalysisResult& result)
+    {
+        return result.date.empty() ? "outreach-state.csv" : "outreach-state-" + result.date + ".csv";
+    }
+
+    std::string OutreachDeltaFileName(const AnalysisResult& result)
+    {
+        return result.date.empty() ? "outreach-delta.csv" : "outreach-delta-" + result.date + ".csv";
+    }
+
+    const char* ToString(Status status)
+    {
+        switch (status)
+        {
+        case Status::OK:
+            return "OK";
+        case Status::INVALID_INPUT:
+            return "Invalid input";
+        case Status::NO_HEADER_ROW:
+            return "No header row";
+        case Status::BAD_HEADER_ROW:
+            return "Bad header row";
+        case Status::PARSE_FAILED:
+            return "Parse failed";
+        case Status::COUNT_FAILED:
+            return "Count failed";
+        default:
+            return "";
+        };
+    }
+
+    const char* ToString(person::MemberType memberType)
+    {
+        switch (memberType)
+        {
+        case person::MemberType::NA:
+            return "N/A";
+        case person::MemberType::MEMBER:
+            return "Member";
+        case person::MemberType::LEADER:
+            return "Leader";
+        case person::MemberType::VISITOR:
+            return "Visitor";
+        default:
+            return "";
+        };
+    }
+
+    const char* ToString(OutreachAction action)
+    {
+        switch (action)
+        {
+        case OutreachAction::TEXT:
+            return "Text";
+        case OutreachAction::POST_CARD:
+            return "Post Card";
+        case OutreachAction::PHONE_CALL:
+            return "Phone Call";
+        case OutreachAction::VISIT:
+            return "Visit";
+        default:
+            return "";
+        };
+    }
+
+    const char* ToString(OutreachChange::Kind kind)
+    {
+        switch (kind)
+        {
+        case OutreachChange::Kind::NEW:
+            return "New";
+        case OutreachChange::Kind::ESCALATED:
+            return "Escalated";
+        case OutreachChange::Kind::RESOLVED:
+            return "Resolved";
+        default:
+            return "";
+        };
+    }
+}
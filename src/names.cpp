@@ -0,0 +1,306 @@
+// names.cpp : Name cells, a vector check for plain ASCII and only past that UTF-8 repair and NFC composition
+//
+
+#include "names.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr char32_t replacementCharacter{ 0xFFFD };
+
+    // A letter and combining accent that NFC composes, sorted by accent then letter
+    struct Composition
+    {
+        uint16_t accent;
+        uint16_t letter;
+        uint16_t composed;
+    };
+
+    // Every letter plus one accent that composes into U+00C0-U+024F or U+1E00-U+1EFF, the letter may itself be composed,
+    //  so a second accent composes again (e, dot below, circumflex)
+    constexpr Composition compositions[] = {
+        { 0x300, 0x0041, 0x00C0 }, { 0x300, 0x0045, 0x00C8 }, { 0x300, 0x0049, 0x00CC }, { 0x300, 0x004E, 0x01F8 }, { 0x300, 0x004F, 0x00D2 }, { 0x300, 0x0055, 0x00D9 },
+        { 0x300, 0x0057, 0x1E80 }, { 0x300, 0x0059, 0x1EF2 }, { 0x300, 0x0061, 0x00E0 }, { 0x300, 0x0065, 0x00E8 }, { 0x300, 0x0069, 0x00EC }, { 0x300, 0x006E, 0x01F9 },
+        { 0x300, 0x006F, 0x00F2 }, { 0x300, 0x0075, 0x00F9 }, { 0x300, 0x0077, 0x1E81 }, { 0x300, 0x0079, 0x1EF3 }, { 0x300, 0x00C2, 0x1EA6 }, { 0x300, 0x00CA, 0x1EC0 },
+        { 0x300, 0x00D4, 0x1ED2 }, { 0x300, 0x00DC, 0x01DB }, { 0x300, 0x00E2, 0x1EA7 }, { 0x300, 0x00EA, 0x1EC1 }, { 0x300, 0x00F4, 0x1ED3 }, { 0x300, 0x00FC, 0x01DC },
+        { 0x300, 0x0102, 0x1EB0 }, { 0x300, 0x0103, 0x1EB1 }, { 0x300, 0x0112, 0x1E14 }, { 0x300, 0x0113, 0x1E15 }, { 0x300, 0x014C, 0x1E50 }, { 0x300, 0x014D, 0x1E51 },
+        { 0x300, 0x01A0, 0x1EDC }, { 0x300, 0x01A1, 0x1EDD }, { 0x300, 0x01AF, 0x1EEA }, { 0x300, 0x01B0, 0x1EEB }, { 0x301, 0x0041, 0x00C1 }, { 0x301, 0x0043, 0x0106 },
+        { 0x301, 0x0045, 0x00C9 }, { 0x301, 0x0047, 0x01F4 }, { 0x301, 0x0049, 0x00CD }, { 0x301, 0x004B, 0x1E30 }, { 0x301, 0x004C, 0x0139 }, { 0x301, 0x004D, 0x1E3E },
+        { 0x301, 0x004E, 0x0143 }, { 0x301, 0x004F, 0x00D3 }, { 0x301, 0x0050, 0x1E54 }, { 0x301, 0x0052, 0x0154 }, { 0x301, 0x0053, 0x015A }, { 0x301, 0x0055, 0x00DA },
+        { 0x301, 0x0057, 0x1E82 }, { 0x301, 0x0059, 0x00DD }, { 0x301, 0x005A, 0x0179 }, { 0x301, 0x0061, 0x00E1 }, { 0x301, 0x0063, 0x0107 }, { 0x301, 0x0065, 0x00E9 },
+        { 0x301, 0x0067, 0x01F5 }, { 0x301, 0x0069, 0x00ED }, { 0x301, 0x006B, 0x1E31 }, { 0x301, 0x006C, 0x013A }, { 0x301, 0x006D, 0x1E3F }, { 0x301, 0x006E, 0x0144 },
+        { 0x301, 0x006F, 0x00F3 }, { 0x301, 0x0070, 0x1E55 }, { 0x301, 0x0072, 0x0155 }, { 0x301, 0x0073, 0x015B }, { 0x301, 0x0075, 0x00FA }, { 0x301, 0x0077, 0x1E83 },
+        { 0x301, 0x0079, 0x00FD }, { 0x301, 0x007A, 0x017A }, { 0x301, 0x00C2, 0x1EA4 }, { 0x301, 0x00C5, 0x01FA }, { 0x301, 0x00C6, 0x01FC }, { 0x301, 0x00C7, 0x1E08 },
+        { 0x301, 0x00CA, 0x1EBE }, { 0x301, 0x00CF, 0x1E2E }, { 0x301, 0x00D4, 0x1ED0 }, { 0x301, 0x00D5, 0x1E4C }, { 0x301, 0x00D8, 0x01FE }, { 0x301, 0x00DC, 0x01D7 },
+        { 0x301, 0x00E2, 0x1EA5 }, { 0x301, 0x00E5, 0x01FB }, { 0x301, 0x00E6, 0x01FD }, { 0x301, 0x00E7, 0x1E09 }, { 0x301, 0x00EA, 0x1EBF }, { 0x301, 0x00EF, 0x1E2F },
+        { 0x301, 0x00F4, 0x1ED1 }, { 0x301, 0x00F5, 0x1E4D }, { 0x301, 0x00F8, 0x01FF }, { 0x301, 0x00FC, 0x01D8 }, { 0x301, 0x0102, 0x1EAE }, { 0x301, 0x0103, 0x1EAF },
+        { 0x301, 0x0112, 0x1E16 }, { 0x301, 0x0113, 0x1E17 }, { 0x301, 0x014C, 0x1E52 }, { 0x301, 0x014D, 0x1E53 }, { 0x301, 0x0168, 0x1E78 }, { 0x301, 0x0169, 0x1E79 },
+        { 0x301, 0x01A0, 0x1EDA }, { 0x301, 0x01A1, 0x1EDB }, { 0x301, 0x01AF, 0x1EE8 }, { 0x301, 0x01B0, 0x1EE9 }, { 0x302, 0x0041, 0x00C2 }, { 0x302, 0x0043, 0x0108 },
+        { 0x302, 0x0045, 0x00CA }, { 0x302, 0x0047, 0x011C }, { 0x302, 0x0048, 0x0124 }, { 0x302, 0x0049, 0x00CE }, { 0x302, 0x004A, 0x0134 }, { 0x302, 0x004F, 0x00D4 },
+        { 0x302, 0x0053, 0x015C }, { 0x302, 0x0055, 0x00DB }, { 0x302, 0x0057, 0x0174 }, { 0x302, 0x0059, 0x0176 }, { 0x302, 0x005A, 0x1E90 }, { 0x302, 0x0061, 0x00E2 },
+        { 0x302, 0x0063, 0x0109 }, { 0x302, 0x0065, 0x00EA }, { 0x302, 0x0067, 0x011D }, { 0x302, 0x0068, 0x0125 }, { 0x302, 0x0069, 0x00EE }, { 0x302, 0x006A, 0x0135 },
+        { 0x302, 0x006F, 0x00F4 }, { 0x302, 0x0073, 0x015D }, { 0x302, 0x0075, 0x00FB }, { 0x302, 0x0077, 0x0175 }, { 0x302, 0x0079, 0x0177 }, { 0x302, 0x007A, 0x1E91 },
+        { 0x302, 0x1EA0, 0x1EAC }, { 0x302, 0x1EA1, 0x1EAD }, { 0x302, 0x1EB8, 0x1EC6 }, { 0x302, 0x1EB9, 0x1EC7 }, { 0x302, 0x1ECC, 0x1ED8 }, { 0x302, 0x1ECD, 0x1ED9 },
+        { 0x303, 0x0041, 0x00C3 }, { 0x303, 0x0045, 0x1EBC }, { 0x303, 0x0049, 0x0128 }, { 0x303, 0x004E, 0x00D1 }, { 0x303, 0x004F, 0x00D5 }, { 0x303, 0x0055, 0x0168 },
+        { 0x303, 0x0056, 0x1E7C }, { 0x303, 0x0059, 0x1EF8 }, { 0x303, 0x0061, 0x00E3 }, { 0x303, 0x0065, 0x1EBD }, { 0x303, 0x0069, 0x0129 }, { 0x303, 0x006E, 0x00F1 },
+        { 0x303, 0x006F, 0x00F5 }, { 0x303, 0x0075, 0x0169 }, { 0x303, 0x0076, 0x1E7D }, { 0x303, 0x0079, 0x1EF9 }, { 0x303, 0x00C2, 0x1EAA }, { 0x303, 0x00CA, 0x1EC4 },
+        { 0x303, 0x00D4, 0x1ED6 }, { 0x303, 0x00E2, 0x1EAB }, { 0x303, 0x00EA, 0x1EC5 }, { 0x303, 0x00F4, 0x1ED7 }, { 0x303, 0x0102, 0x1EB4 }, { 0x303, 0x0103, 0x1EB5 },
+        { 0x303, 0x01A0, 0x1EE0 }, { 0x303, 0x01A1, 0x1EE1 }, { 0x303, 0x01AF, 0x1EEE }, { 0x303, 0x01B0, 0x1EEF }, { 0x304, 0x0041, 0x0100 }, { 0x304, 0x0045, 0x0112 },
+        { 0x304, 0x0047, 0x1E20 }, { 0x304, 0x0049, 0x012A }, { 0x304, 0x004F, 0x014C }, { 0x304, 0x0055, 0x016A }, { 0x304, 0x0059, 0x0232 }, { 0x304, 0x0061, 0x0101 },
+        { 0x304, 0x0065, 0x0113 }, { 0x304, 0x0067, 0x1E21 }, { 0x304, 0x0069, 0x012B }, { 0x304, 0x006F, 0x014D }, { 0x304, 0x0075, 0x016B }, { 0x304, 0x0079, 0x0233 },
+        { 0x304, 0x00C4, 0x01DE }, { 0x304, 0x00C6, 0x01E2 }, { 0x304, 0x00D5, 0x022C }, { 0x304, 0x00D6, 0x022A }, { 0x304, 0x00DC, 0x01D5 }, { 0x304, 0x00E4, 0x01DF },
+        { 0x304, 0x00E6, 0x01E3 }, { 0x304, 0x00F5, 0x022D }, { 0x304, 0x00F6, 0x022B }, { 0x304, 0x00FC, 0x01D6 }, { 0x304, 0x01EA, 0x01EC }, { 0x304, 0x01EB, 0x01ED },
+        { 0x304, 0x0226, 0x01E0 }, { 0x304, 0x0227, 0x01E1 }, { 0x304, 0x022E, 0x0230 }, { 0x304, 0x022F, 0x0231 }, { 0x304, 0x1E36, 0x1E38 }, { 0x304, 0x1E37, 0x1E39 },
+        { 0x304, 0x1E5A, 0x1E5C }, { 0x304, 0x1E5B, 0x1E5D }, { 0x306, 0x0041, 0x0102 }, { 0x306, 0x0045, 0x0114 }, { 0x306, 0x0047, 0x011E }, { 0x306, 0x0049, 0x012C },
+        { 0x306, 0x004F, 0x014E }, { 0x306, 0x0055, 0x016C }, { 0x306, 0x0061, 0x0103 }, { 0x306, 0x0065, 0x0115 }, { 0x306, 0x0067, 0x011F }, { 0x306, 0x0069, 0x012D },
+        { 0x306, 0x006F, 0x014F }, { 0x306, 0x0075, 0x016D }, { 0x306, 0x0228, 0x1E1C }, { 0x306, 0x0229, 0x1E1D }, { 0x306, 0x1EA0, 0x1EB6 }, { 0x306, 0x1EA1, 0x1EB7 },
+        { 0x307, 0x0041, 0x0226 }, { 0x307, 0x0042, 0x1E02 }, { 0x307, 0x0043, 0x010A }, { 0x307, 0x0044, 0x1E0A }, { 0x307, 0x0045, 0x0116 }, { 0x307, 0x0046, 0x1E1E },
+        { 0x307, 0x0047, 0x0120 }, { 0x307, 0x0048, 0x1E22 }, { 0x307, 0x0049, 0x0130 }, { 0x307, 0x004D, 0x1E40 }, { 0x307, 0x004E, 0x1E44 }, { 0x307, 0x004F, 0x022E },
+        { 0x307, 0x0050, 0x1E56 }, { 0x307, 0x0052, 0x1E58 }, { 0x307, 0x0053, 0x1E60 }, { 0x307, 0x0054, 0x1E6A }, { 0x307, 0x0057, 0x1E86 }, { 0x307, 0x0058, 0x1E8A },
+        { 0x307, 0x0059, 0x1E8E }, { 0x307, 0x005A, 0x017B }, { 0x307, 0x0061, 0x0227 }, { 0x307, 0x0062, 0x1E03 }, { 0x307, 0x0063, 0x010B }, { 0x307, 0x0064, 0x1E0B },
+        { 0x307, 0x0065, 0x0117 }, { 0x307, 0x0066, 0x1E1F }, { 0x307, 0x0067, 0x0121 }, { 0x307, 0x0068, 0x1E23 }, { 0x307, 0x006D, 0x1E41 }, { 0x307, 0x006E, 0x1E45 },
+        { 0x307, 0x006F, 0x022F }, { 0x307, 0x0070, 0x1E57 }, { 0x307, 0x0072, 0x1E59 }, { 0x307, 0x0073, 0x1E61 }, { 0x307, 0x0074, 0x1E6B }, { 0x307, 0x0077, 0x1E87 },
+        { 0x307, 0x0078, 0x1E8B }, { 0x307, 0x0079, 0x1E8F }, { 0x307, 0x007A, 0x017C }, { 0x307, 0x015A, 0x1E64 }, { 0x307, 0x015B, 0x1E65 }, { 0x307, 0x0160, 0x1E66 },
+        { 0x307, 0x0161, 0x1E67 }, { 0x307, 0x017F, 0x1E9B }, { 0x307, 0x1E62, 0x1E68 }, { 0x307, 0x1E63, 0x1E69 }, { 0x308, 0x0041, 0x00C4 }, { 0x308, 0x0045, 0x00CB },
+        { 0x308, 0x0048, 0x1E26 }, { 0x308, 0x0049, 0x00CF }, { 0x308, 0x004F, 0x00D6 }, { 0x308, 0x0055, 0x00DC }, { 0x308, 0x0057, 0x1E84 }, { 0x308, 0x0058, 0x1E8C },
+        { 0x308, 0x0059, 0x0178 }, { 0x308, 0x0061, 0x00E4 }, { 0x308, 0x0065, 0x00EB }, { 0x308, 0x0068, 0x1E27 }, { 0x308, 0x0069, 0x00EF }, { 0x308, 0x006F, 0x00F6 },
+        { 0x308, 0x0074, 0x1E97 }, { 0x308, 0x0075, 0x00FC }, { 0x308, 0x0077, 0x1E85 }, { 0x308, 0x0078, 0x1E8D }, { 0x308, 0x0079, 0x00FF }, { 0x308, 0x00D5, 0x1E4E },
+        { 0x308, 0x00F5, 0x1E4F }, { 0x308, 0x016A, 0x1E7A }, { 0x308, 0x016B, 0x1E7B }, { 0x309, 0x0041, 0x1EA2 }, { 0x309, 0x0045, 0x1EBA }, { 0x309, 0x0049, 0x1EC8 },
+        { 0x309, 0x004F, 0x1ECE }, { 0x309, 0x0055, 0x1EE6 }, { 0x309, 0x0059, 0x1EF6 }, { 0x309, 0x0061, 0x1EA3 }, { 0x309, 0x0065, 0x1EBB }, { 0x309, 0x0069, 0x1EC9 },
+        { 0x309, 0x006F, 0x1ECF }, { 0x309, 0x0075, 0x1EE7 }, { 0x309, 0x0079, 0x1EF7 }, { 0x309, 0x00C2, 0x1EA8 }, { 0x309, 0x00CA, 0x1EC2 }, { 0x309, 0x00D4, 0x1ED4 },
+        { 0x309, 0x00E2, 0x1EA9 }, { 0x309, 0x00EA, 0x1EC3 }, { 0x309, 0x00F4, 0x1ED5 }, { 0x309, 0x0102, 0x1EB2 }, { 0x309, 0x0103, 0x1EB3 }, { 0x309, 0x01A0, 0x1EDE },
+        { 0x309, 0x01A1, 0x1EDF }, { 0x309, 0x01AF, 0x1EEC }, { 0x309, 0x01B0, 0x1EED }, { 0x30A, 0x0041, 0x00C5 }, { 0x30A, 0x0055, 0x016E }, { 0x30A, 0x0061, 0x00E5 },
+        { 0x30A, 0x0075, 0x016F }, { 0x30A, 0x0077, 0x1E98 }, { 0x30A, 0x0079, 0x1E99 }, { 0x30B, 0x004F, 0x0150 }, { 0x30B, 0x0055, 0x0170 }, { 0x30B, 0x006F, 0x0151 },
+        { 0x30B, 0x0075, 0x0171 }, { 0x30C, 0x0041, 0x01CD }, { 0x30C, 0x0043, 0x010C }, { 0x30C, 0x0044, 0x010E }, { 0x30C, 0x0045, 0x011A }, { 0x30C, 0x0047, 0x01E6 },
+        { 0x30C, 0x0048, 0x021E }, { 0x30C, 0x0049, 0x01CF }, { 0x30C, 0x004B, 0x01E8 }, { 0x30C, 0x004C, 0x013D }, { 0x30C, 0x004E, 0x0147 }, { 0x30C, 0x004F, 0x01D1 },
+        { 0x30C, 0x0052, 0x0158 }, { 0x30C, 0x0053, 0x0160 }, { 0x30C, 0x0054, 0x0164 }, { 0x30C, 0x0055, 0x01D3 }, { 0x30C, 0x005A, 0x017D }, { 0x30C, 0x0061, 0x01CE },
+        { 0x30C, 0x0063, 0x010D }, { 0x30C, 0x0064, 0x010F }, { 0x30C, 0x0065, 0x011B }, { 0x30C, 0x0067, 0x01E7 }, { 0x30C, 0x0068, 0x021F }, { 0x30C, 0x0069, 0x01D0 },
+        { 0x30C, 0x006A, 0x01F0 }, { 0x30C, 0x006B, 0x01E9 }, { 0x30C, 0x006C, 0x013E }, { 0x30C, 0x006E, 0x0148 }, { 0x30C, 0x006F, 0x01D2 }, { 0x30C, 0x0072, 0x0159 },
+        { 0x30C, 0x0073, 0x0161 }, { 0x30C, 0x0074, 0x0165 }, { 0x30C, 0x0075, 0x01D4 }, { 0x30C, 0x007A, 0x017E }, { 0x30C, 0x00DC, 0x01D9 }, { 0x30C, 0x00FC, 0x01DA },
+        { 0x30C, 0x01B7, 0x01EE }, { 0x30C, 0x0292, 0x01EF }, { 0x30F, 0x0041, 0x0200 }, { 0x30F, 0x0045, 0x0204 }, { 0x30F, 0x0049, 0x0208 }, { 0x30F, 0x004F, 0x020C },
+        { 0x30F, 0x0052, 0x0210 }, { 0x30F, 0x0055, 0x0214 }, { 0x30F, 0x0061, 0x0201 }, { 0x30F, 0x0065, 0x0205 }, { 0x30F, 0x0069, 0x0209 }, { 0x30F, 0x006F, 0x020D },
+        { 0x30F, 0x0072, 0x0211 }, { 0x30F, 0x0075, 0x0215 }, { 0x311, 0x0041, 0x0202 }, { 0x311, 0x0045, 0x0206 }, { 0x311, 0x0049, 0x020A }, { 0x311, 0x004F, 0x020E },
+        { 0x311, 0x0052, 0x0212 }, { 0x311, 0x0055, 0x0216 }, { 0x311, 0x0061, 0x0203 }, { 0x311, 0x0065, 0x0207 }, { 0x311, 0x0069, 0x020B }, { 0x311, 0x006F, 0x020F },
+        { 0x311, 0x0072, 0x0213 }, { 0x311, 0x0075, 0x0217 }, { 0x31B, 0x004F, 0x01A0 }, { 0x31B, 0x0055, 0x01AF }, { 0x31B, 0x006F, 0x01A1 }, { 0x31B, 0x0075, 0x01B0 },
+        { 0x323, 0x0041, 0x1EA0 }, { 0x323, 0x0042, 0x1E04 }, { 0x323, 0x0044, 0x1E0C }, { 0x323, 0x0045, 0x1EB8 }, { 0x323, 0x0048, 0x1E24 }, { 0x323, 0x0049, 0x1ECA },
+        { 0x323, 0x004B, 0x1E32 }, { 0x323, 0x004C, 0x1E36 }, { 0x323, 0x004D, 0x1E42 }, { 0x323, 0x004E, 0x1E46 }, { 0x323, 0x004F, 0x1ECC }, { 0x323, 0x0052, 0x1E5A },
+        { 0x323, 0x0053, 0x1E62 }, { 0x323, 0x0054, 0x1E6C }, { 0x323, 0x0055, 0x1EE4 }, { 0x323, 0x0056, 0x1E7E }, { 0x323, 0x0057, 0x1E88 }, { 0x323, 0x0059, 0x1EF4 },
+        { 0x323, 0x005A, 0x1E92 }, { 0x323, 0x0061, 0x1EA1 }, { 0x323, 0x0062, 0x1E05 }, { 0x323, 0x0064, 0x1E0D }, { 0x323, 0x0065, 0x1EB9 }, { 0x323, 0x0068, 0x1E25 },
+        { 0x323, 0x0069, 0x1ECB }, { 0x323, 0x006B, 0x1E33 }, { 0x323, 0x006C, 0x1E37 }, { 0x323, 0x006D, 0x1E43 }, { 0x323, 0x006E, 0x1E47 }, { 0x323, 0x006F, 0x1ECD },
+        { 0x323, 0x0072, 0x1E5B }, { 0x323, 0x0073, 0x1E63 }, { 0x323, 0x0074, 0x1E6D }, { 0x323, 0x0075, 0x1EE5 }, { 0x323, 0x0076, 0x1E7F }, { 0x323, 0x0077, 0x1E89 },
+        { 0x323, 0x0079, 0x1EF5 }, { 0x323, 0x007A, 0x1E93 }, { 0x323, 0x01A0, 0x1EE2 }, { 0x323, 0x01A1, 0x1EE3 }, { 0x323, 0x01AF, 0x1EF0 }, { 0x323, 0x01B0, 0x1EF1 },
+        { 0x324, 0x0055, 0x1E72 }, { 0x324, 0x0075, 0x1E73 }, { 0x325, 0x0041, 0x1E00 }, { 0x325, 0x0061, 0x1E01 }, { 0x326, 0x0053, 0x0218 }, { 0x326, 0x0054, 0x021A },
+        { 0x326, 0x0073, 0x0219 }, { 0x326, 0x0074, 0x021B }, { 0x327, 0x0043, 0x00C7 }, { 0x327, 0x0044, 0x1E10 }, { 0x327, 0x0045, 0x0228 }, { 0x327, 0x0047, 0x0122 },
+        { 0x327, 0x0048, 0x1E28 }, { 0x327, 0x004B, 0x0136 }, { 0x327, 0x004C, 0x013B }, { 0x327, 0x004E, 0x0145 }, { 0x327, 0x0052, 0x0156 }, { 0x327, 0x0053, 0x015E },
+        { 0x327, 0x0054, 0x0162 }, { 0x327, 0x0063, 0x00E7 }, { 0x327, 0x0064, 0x1E11 }, { 0x327, 0x0065, 0x0229 }, { 0x327, 0x0067, 0x0123 }, { 0x327, 0x0068, 0x1E29 },
+        { 0x327, 0x006B, 0x0137 }, { 0x327, 0x006C, 0x013C }, { 0x327, 0x006E, 0x0146 }, { 0x327, 0x0072, 0x0157 }, { 0x327, 0x0073, 0x015F }, { 0x327, 0x0074, 0x0163 },
+        { 0x328, 0x0041, 0x0104 }, { 0x328, 0x0045, 0x0118 }, { 0x328, 0x0049, 0x012E }, { 0x328, 0x004F, 0x01EA }, { 0x328, 0x0055, 0x0172 }, { 0x328, 0x0061, 0x0105 },
+        { 0x328, 0x0065, 0x0119 }, { 0x328, 0x0069, 0x012F }, { 0x328, 0x006F, 0x01EB }, { 0x328, 0x0075, 0x0173 }, { 0x32D, 0x0044, 0x1E12 }, { 0x32D, 0x0045, 0x1E18 },
+        { 0x32D, 0x004C, 0x1E3C }, { 0x32D, 0x004E, 0x1E4A }, { 0x32D, 0x0054, 0x1E70 }, { 0x32D, 0x0055, 0x1E76 }, { 0x32D, 0x0064, 0x1E13 }, { 0x32D, 0x0065, 0x1E19 },
+        { 0x32D, 0x006C, 0x1E3D }, { 0x32D, 0x006E, 0x1E4B }, { 0x32D, 0x0074, 0x1E71 }, { 0x32D, 0x0075, 0x1E77 }, { 0x32E, 0x0048, 0x1E2A }, { 0x32E, 0x0068, 0x1E2B },
+        { 0x330, 0x0045, 0x1E1A }, { 0x330, 0x0049, 0x1E2C }, { 0x330, 0x0055, 0x1E74 }, { 0x330, 0x0065, 0x1E1B }, { 0x330, 0x0069, 0x1E2D }, { 0x330, 0x0075, 0x1E75 },
+        { 0x331, 0x0042, 0x1E06 }, { 0x331, 0x0044, 0x1E0E }, { 0x331, 0x004B, 0x1E34 }, { 0x331, 0x004C, 0x1E3A }, { 0x331, 0x004E, 0x1E48 }, { 0x331, 0x0052, 0x1E5E },
+        { 0x331, 0x0054, 0x1E6E }, { 0x331, 0x005A, 0x1E94 }, { 0x331, 0x0062, 0x1E07 }, { 0x331, 0x0064, 0x1E0F }, { 0x331, 0x0068, 0x1E96 }, { 0x331, 0x006B, 0x1E35 },
+        { 0x331, 0x006C, 0x1E3B }, { 0x331, 0x006E, 0x1E49 }, { 0x331, 0x0072, 0x1E5F }, { 0x331, 0x0074, 0x1E6F }, { 0x331, 0x007A, 0x1E95 },
+    };
+
+    // Canonical combining classes of U+0300-U+036F, an accent composes with the letter before it unless an accent of the
+    //  same or a higher class comes between them
+    constexpr uint8_t combiningClasses[] = {
+        230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230,
+        230, 230, 230, 230, 230, 232, 220, 220, 220, 220, 232, 216, 220, 220, 220, 220,
+        220, 202, 202, 220, 220, 220, 220, 202, 202, 220, 220, 220, 220, 220, 220, 220,
+        220, 220, 220, 220, 1, 1, 1, 1, 1, 220, 220, 220, 220, 230, 230, 230,
+        230, 230, 230, 230, 230, 240, 230, 220, 220, 220, 230, 230, 230, 220, 220, 0,
+        230, 230, 230, 220, 220, 220, 220, 230, 232, 220, 220, 230, 233, 234, 234, 233,
+        234, 234, 233, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230, 230,
+    };
+
+    int CombiningClass(char32_t codePoint)
+    {
+        return codePoint >= 0x300 && codePoint <= 0x36F ? combiningClasses[codePoint - 0x300] : 0;
+    }
+
+    // Whether every byte is below 0x80, sixteen at a time with SSE2, then eight at a time in a register, then one at a time
+    bool IsAscii(const char* begin, const char* end)
+    {
+#if defined(_M_X64) || defined(__SSE2__)
+        for (; end - begin >= 16; begin += 16)
+        {
+            if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(begin))) != 0)
+                return false;
+        }
+#endif
+        for (; end - begin >= 8; begin += 8)
+        {
+            uint64_t chunk;
+            std::memcpy(&chunk, begin, 8);
+            if (chunk & 0x8080808080808080)
+                return false;
+        }
+        for (; begin != end; ++begin)
+        {
+            if (static_cast<unsigned char>(*begin) >= 0x80)
+                return false;
+        }
+        return true;
+    }
+
+    // The code point at p, moving p past it, or U+FFFD for the longest prefix of a sequence that can't be completed,
+    //  so a bad byte in the middle of a name never swallows the letters after it
+    char32_t NextCodePoint(const unsigned char*& p, const unsigned char* end)
+    {
+        const unsigned char lead{ *p++ };
+        if (lead < 0x80)
+            return lead;
+
+        int continuations;
+        char32_t codePoint;
+        unsigned char low{ 0x80 }, high{ 0xBF }; // the second byte's range, narrower after E0, ED, F0 and F4
+        if (lead >= 0xC2 && lead <= 0xDF)
+        {
+            continuations = 1;
+            codePoint = lead & 0x1F;
+        }
+        else if (lead >= 0xE0 && lead <= 0xEF)
+        {
+            continuations = 2;
+            codePoint = lead & 0x0F;
+            low = lead == 0xE0 ? 0xA0 : 0x80;
+            high = lead == 0xED ? 0x9F : 0xBF;
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4)
+        {
+            continuations = 3;
+            codePoint = lead & 0x07;
+            low = lead == 0xF0 ? 0x90 : 0x80;
+            high = lead == 0xF4 ? 0x8F : 0xBF;
+        }
+        else
+            return replacementCharacter;
+
+        for (int i = 0; i < continuations; ++i)
+        {
+            if (p == end || *p < low || *p > high)
+                return replacementCharacter;
+            codePoint = (codePoint << 6) | (*p++ & 0x3F);
+            low = 0x80;
+            high = 0xBF;
+        }
+        return codePoint;
+    }
+
+    void AppendUtf8(std::string& out, char32_t codePoint)
+    {
+        if (codePoint < 0x80)
+            out.push_back(static_cast<char>(codePoint));
+        else if (codePoint < 0x800)
+        {
+            out.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else if (codePoint < 0x10000)
+        {
+            out.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+    }
+
+    // The precomposed letter, 0 when the pair doesn't compose
+    char32_t Compose(char32_t letter, char32_t accent)
+    {
+        const auto before = [](const Composition& entry, std::pair<char32_t, char32_t> key)
+            {
+                return entry.accent != key.first ? entry.accent < key.first : entry.letter < key.second;
+            };
+        const auto found = std::lower_bound(std::begin(compositions), std::end(compositions), std::make_pair(accent, letter), before);
+        return found != std::end(compositions) && found->accent == accent && found->letter == letter ? found->composed : 0;
+    }
+
+    // The length of the space, tab or U+00A0 at the start of text[at...], 0 for anything else
+    std::size_t LeadingSpace(const std::string& text, std::size_t at)
+    {
+        if (at < text.size() && (text[at] == ' ' || text[at] == '\t'))
+            return 1;
+        if (at + 1 < text.size() && text[at] == '\xC2' && text[at + 1] == '\xA0')
+            return 2;
+        return 0;
+    }
+
+    // The same at the end of text
+    std::size_t TrailingSpace(const std::string& text)
+    {
+        if (!text.empty() && (text.back() == ' ' || text.back() == '\t'))
+            return 1;
+        if (text.size() >= 2 && text[text.size() - 2] == '\xC2' && text.back() == '\xA0')
+            return 2;
+        return 0;
+    }
+}
+
+// begin and end are already trimmed of spaces and tabs, returns begin or repaired's buffer
+const char* NameCodec::clean(char* begin, char* end, std::string& repaired)
+{
+    if (IsAscii(begin, end))
+        return begin;
+
+    repaired.clear();
+    const unsigned char* p{ reinterpret_cast<const unsigned char*>(begin) };
+    const unsigned char* last{ reinterpret_cast<const unsigned char*>(end) };
+    char32_t starter{ 0 };          // the last letter appended, which the accents after it may compose with
+    std::size_t starterAt{ 0 };
+    std::size_t starterLength{ 0 };
+    int lastClass{ 0 };             // the combining class of the last accent left after it, 0 straight after it
+    std::string composedText;
+    while (p != last)
+    {
+        const char32_t codePoint{ NextCodePoint(p, last) };
+        const int combiningClass{ CombiningClass(codePoint) };
+        if (combiningClass != 0 && lastClass < combiningClass)
+        {
+            if (const char32_t composed{ Compose(starter, codePoint) })
+            {
+                composedText.clear();
+                AppendUtf8(composedText, composed);
+                repaired.replace(starterAt, starterLength, composedText);
+                starter = composed;
+                starterLength = composedText.size();
+                continue;
+            }
+        }
+
+        if (combiningClass == 0)
+        {
+            starter = codePoint;
+            starterAt = repaired.size();
+            lastClass = 0;
+        }
+        else
+            lastClass = combiningClass;
+        AppendUtf8(repaired, codePoint);
+        if (combiningClass == 0)
+            starterLength = repaired.size() - starterAt;
+    }
+
+    while (const std::size_t length{ TrailingSpace(repaired) })
+        repaired.resize(repaired.size() - length);
+    std::size_t start{ 0 };
+    while (const std::size_t length{ LeadingSpace(repaired, start) })
+        start += length;
+    repaired.erase(0, start);
+    return repaired.c_str();
+}
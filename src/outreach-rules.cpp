@@ -0,0 +1,136 @@
+// outreach-rules.cpp : The outreach ladder as a table, loaded from a rules file and evaluated for a whole roll at once
+//
+
+#include "outreach-rules.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    bool ParseMemberTypes(const std::string& text, std::size_t& first, std::size_t& last)
+    {
+        if (text == "*")
+        {
+            first = 0;
+            last = 4;
+            return true;
+        }
+
+        static const char* names[] = { "na", "member", "leader", "visitor" };
+        for (std::size_t i = 0; i < 4; ++i)
+        {
+            if (text == names[i])
+            {
+                first = i;
+                last = i + 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // -1 for give-up
+    bool ParseAction(const std::string& text, int& action)
+    {
+        static const char* names[] = { "none", "text", "post-card", "phone-call", "visit" };
+        for (int i = 0; i < 5; ++i)
+        {
+            if (text == names[i])
+            {
+                action = i;
+                return true;
+            }
+        }
+        action = -1;
+        return text == "give-up";
+    }
+}
+
+namespace eya
+{
+    // The ladder the program has always used, 2 Text, 3 Post Card, 4 Phone Call, 5 Visit, give up at 6
+    OutreachRules::OutreachRules()
+    {
+        std::istringstream ladder("* 2 text\n* 3 post-card\n* 4 phone-call\n* 5 visit\n* 6 give-up\n");
+        std::string error;
+        Load(ladder, error);
+    }
+
+    // Replace the rules with the ones in a rules file, returns false with the line at fault and leaves the rules alone
+    bool OutreachRules::Load(std::istream& in, std::string& error)
+    {
+        // Anyone who never gets a give-up rule is reached out to forever
+        std::array<uint8_t, 4 * stride> newTable{};
+        std::array<int32_t, 4> newGiveUp;
+        newGiveUp.fill(max_weeks + 1);
+
+        uint32_t lineNumber{ 0 };
+        for (std::string line; std::getline(in, line);)
+        {
+            ++lineNumber;
+            line.erase(std::find(line.begin(), line.end(), '#'), line.end());
+
+            std::istringstream fields(line);
+            std::string type, action, extra;
+            int32_t weeks{ 0 };
+            if (!(fields >> type))
+                continue;
+
+            std::size_t first, last;
+            int actionValue;
+            if (!(fields >> weeks >> action) || (fields >> extra) || !ParseMemberTypes(type, first, last) || !ParseAction(action, actionValue) ||
+                weeks < 0 || weeks > max_weeks)
+            {
+                error = "Line " + std::to_string(lineNumber) + ": expected \"<member|leader|visitor|na|*> <weeks 0-" + std::to_string(max_weeks) +
+                    "> <text|post-card|phone-call|visit|none|give-up>\", got \"" + line + "\"";
+                return false;
+            }
+
+            for (std::size_t i = first; i < last; ++i)
+            {
+                if (actionValue < 0)
+                    newGiveUp[i] = weeks;
+                else
+                    newTable[i * stride + weeks] = static_cast<uint8_t>(actionValue);
+            }
+        }
+
+        table = newTable;
+        giveUp = newGiveUp;
+        return true;
+    }
+
+    bool OutreachRules::LoadFile(const std::string& path, std::string& error)
+    {
+        std::ifstream in(path);
+        if (!in.good())
+        {
+            error = "Can't open " + path;
+            return false;
+        }
+        return Load(in, error);
+    }
+
+    // Evaluate count members at once from columns of member type, current weeks absent and longest streak so far
+    //  Negative and off the roll streaks clamp to the always NONE column, giving up masks the action to NONE,
+    //  so the loop is loads, a min and a select
+    void OutreachRules::Evaluate(const uint8_t* memberTypes, const int32_t* weeksAbsent, const int32_t* longestStreaks, std::size_t count, OutreachAction* actions) const
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const std::size_t type{ memberTypes[i] & 3u };
+            const std::size_t weeks{ std::min<std::size_t>(static_cast<uint32_t>(weeksAbsent[i]), stride - 1) };
+            const uint8_t action{ table[type * stride + weeks] };
+            actions[i] = static_cast<OutreachAction>(longestStreaks[i] >= giveUp[type] ? 0 : action);
+        }
+    }
+
+    OutreachAction OutreachRules::Action(person::MemberType memberType, int32_t weeksAbsent, int32_t longestStreak) const
+    {
+        const uint8_t type{ static_cast<uint8_t>(memberType) };
+        OutreachAction action;
+        Evaluate(&type, &weeksAbsent, &longestStreak, 1, &action);
+        return action;
+    }
+}
@@ -0,0 +1,152 @@
+// perf-counters.cpp : perf_event_open counter groups used by --perf
+//
+
+#include "perf-counters.h"
+#include <cstring>
+#include <fstream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    // glibc has no wrapper for this syscall
+    int OpenPerfEvent(uint32_t type, uint64_t config, int groupFd)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = groupFd == -1 ? 1 : 0;
+        attr.exclude_kernel = 1; // Required at perf_event_paranoid 2, and we only care about our own code
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+    }
+
+    std::string ParanoidLevel()
+    {
+        std::ifstream in("/proc/sys/kernel/perf_event_paranoid");
+        std::string level;
+        if (!(in >> level))
+            return "unknown";
+        return level;
+    }
+}
+
+PerfCounterGroup::PerfCounterGroup()
+{
+    static const uint64_t configs[PerfCounterValues::COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_MISSES,
+    };
+
+    for (int i = 0; i < PerfCounterValues::COUNT; ++i)
+    {
+        fds[i] = OpenPerfEvent(PERF_TYPE_HARDWARE, configs[i], leader_fd);
+        if (fds[i] == -1)
+        {
+            // Without the leader there is no group, the other counters are optional (some VMs lack them)
+            if (i == 0)
+            {
+                const int err = errno;
+                error = std::string("perf_event_open failed: ") + std::strerror(err);
+                if (err == EACCES || err == EPERM)
+                    error += " (kernel.perf_event_paranoid is " + ParanoidLevel() + ", 2 or lower is needed)";
+                return;
+            }
+            continue;
+        }
+
+        if (i == 0)
+            leader_fd = fds[i];
+        ioctl(fds[i], PERF_EVENT_IOC_ID, &ids[i]);
+    }
+}
+
+PerfCounterGroup::~PerfCounterGroup()
+{
+    for (int fd : fds)
+    {
+        if (fd != -1)
+            close(fd);
+    }
+}
+
+void PerfCounterGroup::Start()
+{
+    if (leader_fd == -1)
+        return;
+    ioctl(leader_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounterValues PerfCounterGroup::Stop()
+{
+    PerfCounterValues result;
+    if (leader_fd == -1)
+        return result;
+
+    ioctl(leader_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, then { value, id } * nr
+    uint64_t buffer[3 + 2 * PerfCounterValues::COUNT]{};
+    if (read(leader_fd, buffer, sizeof(buffer)) <= 0)
+        return result;
+
+    const uint64_t count = buffer[0];
+    const uint64_t enabled = buffer[1];
+    const uint64_t running = buffer[2];
+
+    // Scale up if the kernel had to multiplex the group
+    const double scale = (running != 0 && running < enabled) ? static_cast<double>(enabled) / running : 1.0;
+
+    for (uint64_t n = 0; n < count && n < PerfCounterValues::COUNT; ++n)
+    {
+        const uint64_t value = buffer[3 + 2 * n];
+        const uint64_t id = buffer[4 + 2 * n];
+        for (int i = 0; i < PerfCounterValues::COUNT; ++i)
+        {
+            if (fds[i] != -1 && ids[i] == id)
+            {
+                result.available[i] = true;
+                result.values[i] = static_cast<uint64_t>(value * scale);
+            }
+        }
+    }
+    result.valid = running != 0;
+
+    return result;
+}
+
+#else
+
+PerfCounterGroup::PerfCounterGroup()
+{
+    error = "hardware counters are only supported on Linux (perf_event_open)";
+}
+
+PerfCounterGroup::~PerfCounterGroup() {}
+
+void PerfCounterGroup::Start() {}
+
+PerfCounterValues PerfCounterGroup::Stop()
+{
+    return {};
+}
+
+#endif
+
+bool PerfCountersSupported(std::string& reason)
+{
+    PerfCounterGroup probe;
+    reason = probe.Error();
+    return probe.IsAvailable();
+}
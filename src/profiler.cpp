@@ -0,0 +1,284 @@
+// profiler.cpp : Stage timing, I/O and heap allocation accounting behind --profile
+//
+
+#include "profiler.h"
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <ctime>
+#endif
+
+namespace profiler_detail
+{
+    std::atomic<bool> enabled{ false };
+}
+
+namespace
+{
+    bool hardwareCountersEnabled{ false };
+}
+
+namespace
+{
+    std::atomic<uint64_t> allocationCount{ 0 };
+    std::atomic<uint64_t> allocatedBytes{ 0 };
+
+    std::chrono::steady_clock::time_point profileEpoch{};
+    std::mutex stagesLock;
+    std::vector<ProfileStats> stages;
+
+    thread_local ProfileStage* currentStage{ nullptr };
+
+    // CPU time consumed by the whole process so far
+    double ProcessCpuMilliseconds()
+    {
+#ifdef _WIN32
+        FILETIME creation, exit, kernel, user;
+        if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+            return 0;
+
+        // FILETIME is in 100ns ticks
+        ULARGE_INTEGER k, u;
+        k.LowPart = kernel.dwLowDateTime;
+        k.HighPart = kernel.dwHighDateTime;
+        u.LowPart = user.dwLowDateTime;
+        u.HighPart = user.dwHighDateTime;
+        return static_cast<double>(k.QuadPart + u.QuadPart) / 10000.0;
+#else
+        timespec ts{};
+        if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+            return 0;
+        return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+#endif
+    }
+
+    // Minimal JSON string escaping for stage names
+    std::string EscapeJson(const std::string& s)
+    {
+        std::string escaped;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+}
+
+void EnableProfiling()
+{
+    profileEpoch = std::chrono::steady_clock::now();
+    profiler_detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+bool EnableHardwareCounters(std::string& reason)
+{
+    hardwareCountersEnabled = PerfCountersSupported(reason);
+    return hardwareCountersEnabled;
+}
+
+void ProfileRecordAllocation(std::size_t size)
+{
+    if (!ProfilingEnabled())
+        return;
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void ProfileAddBytesRead(uint64_t bytes)
+{
+    if (ProfilingEnabled() && currentStage)
+        currentStage->stats.bytes_read += bytes;
+}
+
+void ProfileAddBytesWritten(uint64_t bytes)
+{
+    if (ProfilingEnabled() && currentStage)
+        currentStage->stats.bytes_written += bytes;
+}
+
+void ProfileAddRows(uint64_t rows)
+{
+    if (ProfilingEnabled() && currentStage)
+        currentStage->stats.rows += rows;
+}
+
+void ProfileAddCells(uint64_t cells)
+{
+    if (ProfilingEnabled() && currentStage)
+        currentStage->stats.cells += cells;
+}
+
+ProfileStage::ProfileStage(const char* name)
+{
+    if (!ProfilingEnabled())
+        return;
+
+    active = true;
+    parent = currentStage;
+    currentStage = this;
+
+    stats.name = name;
+    stats.depth = parent ? parent->stats.depth + 1 : 0;
+
+    // Reserve our slot now so the summary lists stages in the order they started
+    {
+        std::lock_guard<std::mutex> guard(stagesLock);
+        index = stages.size();
+        stages.emplace_back();
+    }
+
+    if (hardwareCountersEnabled)
+        counters = std::make_unique<PerfCounterGroup>();
+
+    allocations_start = allocationCount.load(std::memory_order_relaxed);
+    allocated_bytes_start = allocatedBytes.load(std::memory_order_relaxed);
+    cpu_start_ms = ProcessCpuMilliseconds();
+    wall_start = std::chrono::steady_clock::now();
+    if (counters)
+        counters->Start();
+}
+
+ProfileStage::~ProfileStage()
+{
+    if (!active)
+        return;
+
+    if (counters)
+        stats.counters = counters->Stop();
+
+    const auto wall_end = std::chrono::steady_clock::now();
+    stats.cpu_ms = ProcessCpuMilliseconds() - cpu_start_ms;
+    stats.wall_ms = std::chrono::duration<double, std::milli>(wall_end - wall_start).count();
+    stats.start_us = std::chrono::duration<double, std::micro>(wall_start - profileEpoch).count();
+    stats.allocations = allocationCount.load(std::memory_order_relaxed) - allocations_start;
+    stats.allocated_bytes = allocatedBytes.load(std::memory_order_relaxed) - allocated_bytes_start;
+
+    currentStage = parent;
+
+    std::lock_guard<std::mutex> guard(stagesLock);
+    stages[index] = std::move(stats);
+}
+
+void PrintProfileSummary(std::ostream& out)
+{
+    std::lock_guard<std::mutex> guard(stagesLock);
+
+    out << std::left << std::setw(32) << "Stage"
+        << std::right << std::setw(12) << "Wall ms"
+        << std::setw(12) << "CPU ms"
+        << std::setw(14) << "Bytes read"
+        << std::setw(14) << "Bytes written"
+        << std::setw(10) << "Rows"
+        << std::setw(12) << "Allocs"
+        << std::setw(14) << "Alloc bytes" << "\n";
+
+    for (const auto& stage : stages)
+    {
+        out << std::left << std::setw(32) << (std::string(stage.depth * 2, ' ') + stage.name)
+            << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << stage.wall_ms
+            << std::setw(12) << stage.cpu_ms
+            << std::setw(14) << stage.bytes_read
+            << std::setw(14) << stage.bytes_written
+            << std::setw(10) << stage.rows
+            << std::setw(12) << stage.allocations
+            << std::setw(14) << stage.allocated_bytes << "\n";
+    }
+    out << std::defaultfloat << std::endl;
+
+    if (!hardwareCountersEnabled)
+        return;
+
+    // Per row and per cell figures make stages with different input sizes comparable
+    auto perUnit = [](const PerfCounterValues& c, PerfCounterValues::Counter which, uint64_t units) -> std::string
+        {
+            if (!c.Has(which) || units == 0)
+                return "-";
+            std::ostringstream s;
+            s << std::fixed << std::setprecision(3) << static_cast<double>(c.values[which]) / units;
+            return s.str();
+        };
+
+    out << std::left << std::setw(32) << "Stage"
+        << std::right << std::setw(14) << "Cycles"
+        << std::setw(14) << "Instructions"
+        << std::setw(8) << "IPC"
+        << std::setw(14) << "Br miss/row"
+        << std::setw(14) << "$ miss/row"
+        << std::setw(14) << "Br miss/cell"
+        << std::setw(14) << "$ miss/cell" << "\n";
+
+    for (const auto& stage : stages)
+    {
+        const auto& c = stage.counters;
+        std::string ipc = "-";
+        if (c.Has(PerfCounterValues::CYCLES) && c.Has(PerfCounterValues::INSTRUCTIONS) && c.values[PerfCounterValues::CYCLES] != 0)
+        {
+            std::ostringstream s;
+            s << std::fixed << std::setprecision(2) << static_cast<double>(c.values[PerfCounterValues::INSTRUCTIONS]) / c.values[PerfCounterValues::CYCLES];
+            ipc = s.str();
+        }
+
+        out << std::left << std::setw(32) << (std::string(stage.depth * 2, ' ') + stage.name)
+            << std::right
+            << std::setw(14) << (c.Has(PerfCounterValues::CYCLES) ? std::to_string(c.values[PerfCounterValues::CYCLES]) : "-")
+            << std::setw(14) << (c.Has(PerfCounterValues::INSTRUCTIONS) ? std::to_string(c.values[PerfCounterValues::INSTRUCTIONS]) : "-")
+            << std::setw(8) << ipc
+            << std::setw(14) << perUnit(c, PerfCounterValues::BRANCH_MISSES, stage.rows)
+            << std::setw(14) << perUnit(c, PerfCounterValues::CACHE_MISSES, stage.rows)
+            << std::setw(14) << perUnit(c, PerfCounterValues::BRANCH_MISSES, stage.cells)
+            << std::setw(14) << perUnit(c, PerfCounterValues::CACHE_MISSES, stage.cells) << "\n";
+    }
+    out << std::endl;
+}
+
+bool WriteProfileTrace(const std::string& filePath)
+{
+    std::ofstream outFile(filePath);
+    if (!outFile.good())
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(stagesLock);
+
+    // Complete ("X") events, one per stage, all on a single track
+    outFile << "{\"traceEvents\":[";
+    for (std::size_t i = 0; i < stages.size(); ++i)
+    {
+        const auto& stage = stages[i];
+        outFile << (i ? ",\n" : "\n")
+            << std::fixed << std::setprecision(3)
+            << "{\"name\":\"" << EscapeJson(stage.name) << "\",\"cat\":\"stage\",\"ph\":\"X\""
+            << ",\"ts\":" << stage.start_us
+            << ",\"dur\":" << stage.wall_ms * 1000.0
+            << ",\"pid\":1,\"tid\":1,\"args\":{"
+            << "\"cpu_ms\":" << stage.cpu_ms
+            << ",\"bytes_read\":" << stage.bytes_read
+            << ",\"bytes_written\":" << stage.bytes_written
+            << ",\"rows\":" << stage.rows
+            << ",\"cells\":" << stage.cells
+            << ",\"allocations\":" << stage.allocations
+            << ",\"allocated_bytes\":" << stage.allocated_bytes;
+        static const char* counterNames[PerfCounterValues::COUNT] = { "cycles", "instructions", "branch_misses", "cache_misses" };
+        for (int c = 0; c < PerfCounterValues::COUNT; ++c)
+        {
+            if (stage.counters.Has(static_cast<PerfCounterValues::Counter>(c)))
+                outFile << ",\"" << counterNames[c] << "\":" << stage.counters.values[c];
+        }
+        outFile << "}}";
+    }
+    outFile << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    return outFile.good();
+}
@@ -0,0 +1,623 @@
+// query-server.cpp : --serve, a small read-only HTTP/JSON server over the latest roll
+//
+
+#include "query-server.h"
+#include "attendance.h"
+#include "dates.h"
+#include "eya-attendance.h"
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+    using SocketHandle = SOCKET;
+
+    void CloseSocket(SocketHandle s)
+    {
+        closesocket(s);
+    }
+
+    int PollSocket(SocketHandle s, int timeoutMs)
+    {
+        WSAPOLLFD fds{ s, POLLRDNORM, 0 };
+        return WSAPoll(&fds, 1, timeoutMs);
+    }
+#else
+    using SocketHandle = int;
+
+    void CloseSocket(SocketHandle s)
+    {
+        close(s);
+    }
+
+    int PollSocket(SocketHandle s, int timeoutMs)
+    {
+        pollfd fds{ s, POLLIN, 0 };
+        return poll(&fds, 1, timeoutMs);
+    }
+#endif
+
+#ifdef MSG_NOSIGNAL
+    constexpr int sendFlags{ MSG_NOSIGNAL }; // a client hanging up early shouldn't SIGPIPE the whole process
+#else
+    constexpr int sendFlags{ 0 };
+#endif
+
+    SocketHandle ToSocket(std::intptr_t handle)
+    {
+        return static_cast<SocketHandle>(handle);
+    }
+
+    bool SendAll(SocketHandle s, const std::string& data)
+    {
+        std::size_t sent{ 0 };
+        while (sent < data.size())
+        {
+            const auto count = send(s, data.data() + sent, static_cast<int>(data.size() - sent), sendFlags);
+            if (count <= 0)
+                return false;
+            sent += static_cast<std::size_t>(count);
+        }
+        return true;
+    }
+
+    void AppendJsonString(std::string& out, std::string_view s)
+    {
+        out += '"';
+        for (unsigned char c : s)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += static_cast<char>(c);
+            }
+            else if (c < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            }
+            else
+            {
+                out += static_cast<char>(c);
+            }
+        }
+        out += '"';
+    }
+
+    const char* AttendanceName(person::AttendanceType type)
+    {
+        switch (type)
+        {
+        case person::AttendanceType::NOT_TAKEN:
+            return "not taken";
+        case person::AttendanceType::PRESENT:
+            return "present";
+        case person::AttendanceType::NOT_PRESENT:
+            return "not present";
+        case person::AttendanceType::VISITING:
+            return "visiting";
+        case person::AttendanceType::NA:
+        default:
+            return "n/a";
+        };
+    }
+
+    // One member as a JSON object, with every Sunday when history is set
+    void AppendMember(std::string& out, const eya::AnalysisResult& result, uint32_t index, bool history)
+    {
+        const person& member{ result.roll[index] };
+        const int32_t weeksAbsent{ member.attendance_list.empty() ? 99 : member.attendance_list.back().weeks_absent };
+
+        out += "{\"id\":" + std::to_string(index) + ",\"first_name\":";
+        AppendJsonString(out, member.first_name);
+        out += ",\"last_name\":";
+        AppendJsonString(out, member.last_name);
+        out += ",\"member_type\":";
+        AppendJsonString(out, eya::ToString(member.member_type));
+        out += ",\"weeks_absent\":" + std::to_string(weeksAbsent) + ",\"action\":";
+        AppendJsonString(out, eya::ToString(index < result.actions.size() ? result.actions[index] : eya::OutreachAction::NONE));
+
+        if (history)
+        {
+            out += ",\"history\":[";
+            for (std::size_t i = 0; i < member.attendance_list.size(); ++i)
+            {
+                const auto& attendance = member.attendance_list[i];
+                out += i ? ",{\"date\":" : "{\"date\":";
+                AppendJsonString(out, attendance.date);
+                out += ",\"status\":";
+                AppendJsonString(out, AttendanceName(attendance.type));
+                out += ",\"weeks_absent\":" + std::to_string(attendance.weeks_absent) + "}";
+            }
+            out += "]";
+        }
+        out += "}";
+    }
+
+    void AppendMembers(std::string& out, const eya::AnalysisResult& result, const std::vector<uint32_t>& members, bool history)
+    {
+        out += "\"count\":" + std::to_string(members.size()) + ",\"members\":[";
+        for (std::size_t i = 0; i < members.size(); ++i)
+        {
+            if (i)
+                out += ",";
+            AppendMember(out, result, members[i], history);
+        }
+        out += "]";
+    }
+
+    std::string UrlDecode(std::string_view s)
+    {
+        std::string decoded;
+        for (std::size_t i = 0; i < s.size(); ++i)
+        {
+            unsigned value{ 0 };
+            if (s[i] == '+')
+                decoded += ' ';
+            else if (s[i] == '%' && i + 2 < s.size() && std::from_chars(s.data() + i + 1, s.data() + i + 3, value, 16).ptr == s.data() + i + 3)
+            {
+                decoded += static_cast<char>(value);
+                i += 2;
+            }
+            else
+                decoded += s[i];
+        }
+        return decoded;
+    }
+
+    // The decoded value of one query string parameter
+    bool QueryParameter(std::string_view query, std::string_view name, std::string& value)
+    {
+        while (!query.empty())
+        {
+            const auto end = query.find('&');
+            const std::string_view pair{ query.substr(0, end) };
+            const auto equals = pair.find('=');
+            if (pair.substr(0, equals) == name)
+            {
+                value = equals == std::string_view::npos ? "" : UrlDecode(pair.substr(equals + 1));
+                return true;
+            }
+            if (end == std::string_view::npos)
+                break;
+            query.remove_prefix(end + 1);
+        }
+        return false;
+    }
+
+    // yyyy-mm, nothing before or after
+    bool ParseMonth(const std::string& text, int& year, unsigned& month)
+    {
+        const char* end{ text.data() + text.size() };
+        const auto [dash, yearError] = std::from_chars(text.data(), end, year);
+        if (yearError != std::errc() || dash == end || *dash != '-')
+            return false;
+        const auto [last, monthError] = std::from_chars(dash + 1, end, month);
+        return monthError == std::errc() && last == end && month >= 1 && month <= 12;
+    }
+
+    // yyyy-mm-dd as a day number (dates.h), nothing before or after
+    bool ParseDay(const std::string& text, int64_t& day)
+    {
+        int year{ 0 };
+        unsigned month{ 0 }, dayOfMonth{ 0 };
+        const char* end{ text.data() + text.size() };
+        const auto [dash, yearError] = std::from_chars(text.data(), end, year);
+        if (yearError != std::errc() || dash == end || *dash != '-')
+            return false;
+        const auto [secondDash, monthError] = std::from_chars(dash + 1, end, month);
+        if (monthError != std::errc() || secondDash == end || *secondDash != '-' || month < 1 || month > 12)
+            return false;
+        const auto [last, dayError] = std::from_chars(secondDash + 1, end, dayOfMonth);
+        if (dayError != std::errc() || last != end || dayOfMonth < 1 || dayOfMonth > DaysInMonth(year, month))
+            return false;
+        day = DaysFromCivil(year, month, dayOfMonth);
+        return true;
+    }
+
+    // The header of a Sunday column, empty before the first one
+    std::string SundayHeader(const eya::AnalysisResult& result, int32_t column)
+    {
+        return column < 0 || static_cast<std::size_t>(column) + 2 >= result.headers.size() ? std::string() : result.headers[column + 2];
+    }
+
+    int Error(std::string& body, int code, const std::string& message)
+    {
+        body = "{\"error\":";
+        AppendJsonString(body, message);
+        body += "}";
+        return code;
+    }
+}
+
+QueryServer::~QueryServer()
+{
+    Stop();
+    if (listener != -1)
+    {
+        CloseSocket(ToSocket(listener));
+#ifdef _WIN32
+        WSACleanup();
+#else
+        if (!unixPath.empty())
+            unlink(unixPath.c_str());
+#endif
+    }
+}
+
+// Listen on "port" (127.0.0.1 only) or "unix:/path/to/socket", returns false with a reason on failure
+bool QueryServer::Open(const std::string& address, std::string& reason)
+{
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        reason = "WSAStartup failed";
+        return false;
+    }
+#endif
+
+    SocketHandle s;
+    if (address.starts_with("unix:"))
+    {
+#ifdef _WIN32
+        reason = "Unix sockets aren't supported here, give a port instead";
+        return false;
+#else
+        sockaddr_un local{};
+        local.sun_family = AF_UNIX;
+        const std::string path{ address.substr(5) };
+        if (path.empty() || path.size() >= sizeof(local.sun_path))
+        {
+            reason = "Bad socket path: " + path;
+            return false;
+        }
+        std::memcpy(local.sun_path, path.c_str(), path.size() + 1);
+
+        s = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path.c_str()); // left over from a run that didn't stop cleanly
+        if (s < 0 || bind(s, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0 || listen(s, 16) != 0)
+        {
+            reason = "Can't listen on " + path + ": " + std::strerror(errno);
+            if (s >= 0)
+                CloseSocket(s);
+            return false;
+        }
+        unixPath = path;
+#endif
+    }
+    else
+    {
+        uint16_t port{ 0 };
+        const auto [end, ec] = std::from_chars(address.data(), address.data() + address.size(), port);
+        if (ec != std::errc() || end != address.data() + address.size() || port == 0)
+        {
+            reason = "Expected a port or unix:/path, got " + address;
+            return false;
+        }
+
+        // Loopback only, the roll has people's names in it
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_port = htons(port);
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        s = socket(AF_INET, SOCK_STREAM, 0);
+        const int reuse{ 1 };
+        if (s == static_cast<SocketHandle>(-1) ||
+            setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse)) != 0 ||
+            bind(s, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0 || listen(s, 16) != 0)
+        {
+            reason = "Can't listen on 127.0.0.1:" + address;
+            if (s != static_cast<SocketHandle>(-1))
+                CloseSocket(s);
+            return false;
+        }
+    }
+
+    listener = static_cast<std::intptr_t>(s);
+    return true;
+}
+
+void QueryServer::Start()
+{
+    stopping = false;
+    thread = std::thread(&QueryServer::Run, this);
+}
+
+void QueryServer::Stop()
+{
+    stopping = true;
+    if (thread.joinable())
+        thread.join();
+}
+
+// Swap in a new index, requests already being answered finish on the one they started with
+void QueryServer::Publish(std::shared_ptr<const RollIndex> index)
+{
+    current.store(std::move(index));
+}
+
+void QueryServer::Run()
+{
+    while (!stopping)
+    {
+        // Wake up now and then to notice Stop()
+        if (PollSocket(ToSocket(listener), 200) <= 0)
+            continue;
+
+        const SocketHandle client{ accept(ToSocket(listener), nullptr, nullptr) };
+        if (client == static_cast<SocketHandle>(-1))
+            continue;
+
+        HandleConnection(static_cast<std::intptr_t>(client));
+        CloseSocket(client);
+    }
+}
+
+// Read one GET request and send back its answer, one slow client holds up the rest for at most a second
+void QueryServer::HandleConnection(std::intptr_t handle)
+{
+    const SocketHandle client{ ToSocket(handle) };
+#ifdef _WIN32
+    const DWORD timeout{ 1000 };
+#else
+    const timeval timeout{ 1, 0 };
+#endif
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+
+    std::string request;
+    char buffer[4096];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 16 * 1024)
+    {
+        const auto count = recv(client, buffer, sizeof(buffer), 0);
+        if (count <= 0)
+            return;
+        request.append(buffer, static_cast<std::size_t>(count));
+    }
+
+    // Request line, "GET /streak?weeks=3 HTTP/1.1"
+    const auto lineEnd = request.find("\r\n");
+    const std::string_view line{ request.data(), lineEnd == std::string::npos ? request.size() : lineEnd };
+    const auto firstSpace = line.find(' ');
+    const auto secondSpace = line.find(' ', firstSpace + 1);
+
+    std::string body;
+    int code;
+    const auto start = std::chrono::steady_clock::now();
+    if (firstSpace == std::string_view::npos || secondSpace == std::string_view::npos)
+        code = Error(body, 400, "bad request");
+    else if (line.substr(0, firstSpace) != "GET")
+        code = Error(body, 405, "only GET is supported");
+    else
+        code = Answer(std::string(line.substr(firstSpace + 1, secondSpace - firstSpace - 1)), body);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    const char* reasonPhrase = code == 200 ? "OK" : code == 400 ? "Bad Request" : code == 404 ? "Not Found"
+        : code == 405 ? "Method Not Allowed" : "Service Unavailable";
+    std::string response{ "HTTP/1.1 " + std::to_string(code) + " " + reasonPhrase + "\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        "X-Query-Time-Us: " + std::to_string(elapsed.count()) + "\r\n"
+        "Connection: close\r\n\r\n" };
+    response += body;
+    SendAll(client, response);
+}
+
+// Route one request target (path and query string) to its JSON answer, returns the HTTP status code
+int QueryServer::Answer(const std::string& target, std::string& body) const
+{
+    // Hold on to this index for the whole answer, a reload can swap in another one meanwhile
+    const std::shared_ptr<const RollIndex> index{ current.load() };
+    if (!index)
+        return Error(body, 503, "no export loaded yet");
+    const eya::AnalysisResult& result{ index->Result() };
+
+    const auto question = target.find('?');
+    const std::string_view path{ target.data(), question == std::string::npos ? target.size() : question };
+    const std::string_view query{ question == std::string::npos ? std::string_view{} : std::string_view{ target }.substr(question + 1) };
+
+    std::string value;
+    if (path == "/status")
+    {
+        body = "{\"date\":";
+        AppendJsonString(body, result.date);
+        body += ",\"members\":" + std::to_string(result.roll.size());
+        body += ",\"sundays\":" + std::to_string(result.headers.size() > 2 ? result.headers.size() - 2 : 0);
+        body += ",\"first_sunday\":";
+        AppendJsonString(body, result.headers.size() > 2 ? result.headers[2] : "");
+        body += ",\"last_sunday\":";
+        AppendJsonString(body, result.headers.size() > 2 ? result.headers.back() : "");
+        body += ",\"outreach\":" + std::to_string(result.outreach.size()) + "}";
+        return 200;
+    }
+    else if (path == "/streak")
+    {
+        if (!QueryParameter(query, "weeks", value))
+            return Error(body, 400, "weeks is required, 0-5, 6+ or na");
+
+        RollIndex::Bucket bucket;
+        if (value == "6+")
+            bucket = RollIndex::WEEKS_6_PLUS;
+        else if (value == "na")
+            bucket = RollIndex::OFF_ROLL;
+        else if (value.size() == 1 && value[0] >= '0' && value[0] <= '5')
+            bucket = static_cast<RollIndex::Bucket>(value[0] - '0');
+        else
+            return Error(body, 400, "weeks must be 0-5, 6+ or na");
+
+        body = "{\"weeks\":";
+        AppendJsonString(body, value);
+
+        // As of an earlier Sunday, everyone's streak then in one sweep over the streak index
+        std::string date;
+        if (QueryParameter(query, "date", date))
+        {
+            int64_t day{ 0 };
+            if (!ParseDay(date, day))
+                return Error(body, 400, "date must be yyyy-mm-dd");
+
+            const StreakIndex& streaks{ index->Streaks() };
+            const int32_t column{ streaks.ColumnAt(day) };
+            std::vector<int32_t> weeksAbsent;
+            streaks.WeeksAbsentAll(column, weeksAbsent);
+
+            std::vector<uint32_t> members;
+            for (uint32_t member = 0; member < weeksAbsent.size(); ++member)
+            {
+                if (RollIndex::BucketFor(weeksAbsent[member]) == bucket)
+                    members.push_back(member);
+            }
+
+            body += ",\"as_of\":";
+            AppendJsonString(body, SundayHeader(result, column));
+            body += ",";
+            AppendMembers(body, result, members, false);
+        }
+        else
+        {
+            body += ",";
+            AppendMembers(body, result, index->ByBucket(bucket), false);
+        }
+        body += "}";
+        return 200;
+    }
+    else if (path == "/crossed")
+    {
+        std::string from, to;
+        if (!QueryParameter(query, "weeks", value) || !QueryParameter(query, "from", from) || !QueryParameter(query, "to", to))
+            return Error(body, 400, "weeks, from and to are required");
+
+        int32_t weeks{ 0 };
+        const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), weeks);
+        if (ec != std::errc() || end != value.data() + value.size() || weeks < 1 || weeks > 98)
+            return Error(body, 400, "weeks must be 1-98");
+
+        int64_t fromDay{ 0 }, toDay{ 0 };
+        if (!ParseDay(from, fromDay) || !ParseDay(to, toDay))
+            return Error(body, 400, "from and to must be yyyy-mm-dd");
+
+        // Sundays after from, up to and including to
+        const StreakIndex& streaks{ index->Streaks() };
+        const int32_t fromColumn{ streaks.ColumnAt(fromDay) };
+        const int32_t toColumn{ streaks.ColumnAt(toDay) };
+        std::vector<uint32_t> members;
+        streaks.CrossedAll(weeks, fromColumn, toColumn, members);
+
+        body = "{\"weeks\":" + std::to_string(weeks) + ",\"from\":";
+        AppendJsonString(body, from);
+        body += ",\"to\":";
+        AppendJsonString(body, to);
+        body += ",";
+        AppendMembers(body, result, members, false);
+        body += "}";
+        return 200;
+    }
+    else if (path == "/person")
+    {
+        if (!QueryParameter(query, "name", value))
+            return Error(body, 400, "name is required, \"first last\"");
+
+        body = "{\"name\":";
+        AppendJsonString(body, value);
+        body += ",";
+        AppendMembers(body, result, index->ByName(value), true);
+        body += "}";
+        return 200;
+    }
+    else if (path == "/members")
+    {
+        if (!QueryParameter(query, "type", value))
+            return Error(body, 400, "type is required, member, leader, visitor or na");
+
+        person::MemberType memberType;
+        if (value == "member")
+            memberType = person::MemberType::MEMBER;
+        else if (value == "leader")
+            memberType = person::MemberType::LEADER;
+        else if (value == "visitor")
+            memberType = person::MemberType::VISITOR;
+        else if (value == "na")
+            memberType = person::MemberType::NA;
+        else
+            return Error(body, 400, "type must be member, leader, visitor or na");
+
+        body = "{\"type\":";
+        AppendJsonString(body, value);
+
+        // Narrow down to those who were there at least once in the month
+        std::string month;
+        if (QueryParameter(query, "month", month))
+        {
+            int year{ 0 };
+            unsigned monthNumber{ 0 };
+            if (!ParseMonth(month, year, monthNumber))
+                return Error(body, 400, "month must be yyyy-mm");
+
+            uint32_t first, last;
+            index->MonthColumns(year, monthNumber, first, last);
+
+            std::vector<uint32_t> attended;
+            for (uint32_t member : index->ByMemberType(memberType))
+            {
+                const auto& attendanceList = result.roll[member].attendance_list;
+                for (uint32_t i = first; i < last && i < attendanceList.size(); ++i)
+                {
+                    if (attendanceList[i].type == person::AttendanceType::PRESENT || attendanceList[i].type == person::AttendanceType::VISITING)
+                    {
+                        attended.push_back(member);
+                        break;
+                    }
+                }
+            }
+
+            body += ",\"month\":";
+            AppendJsonString(body, month);
+            body += ",";
+            AppendMembers(body, result, attended, false);
+        }
+        else
+        {
+            body += ",";
+            AppendMembers(body, result, index->ByMemberType(memberType), false);
+        }
+        body += "}";
+        return 200;
+    }
+    else if (path == "/outreach")
+    {
+        std::vector<uint32_t> members;
+        members.reserve(result.outreach.size());
+        for (const auto& entry : result.outreach)
+            members.push_back(entry.member);
+
+        body = "{";
+        AppendMembers(body, result, members, false);
+        body += "}";
+        return 200;
+    }
+
+    return Error(body, 404, "unknown query, try /status, /streak, /crossed, /person, /members or /outreach");
+}
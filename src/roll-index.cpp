@@ -0,0 +1,80 @@
+// roll-index.cpp : Name, streak and member type indexes over an analysis for the query server
+//
+
+#include "roll-index.h"
+#include "attendance.h"
+#include "dates.h"
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+    std::string ToLower(std::string s)
+    {
+        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return s;
+    }
+}
+
+RollIndex::RollIndex(std::shared_ptr<const eya::AnalysisResult> analysis) : result(std::move(analysis))
+{
+    const auto& roll = result->roll;
+    names.reserve(roll.size());
+    for (uint32_t i = 0; i < roll.size(); ++i)
+    {
+        const person& member{ roll[i] };
+        names[NameKey(member.first_name, member.last_name)].push_back(i);
+        memberTypes[static_cast<std::size_t>(member.member_type)].push_back(i);
+        if (!member.attendance_list.empty())
+            buckets[BucketFor(member.attendance_list.back().weeks_absent)].push_back(i);
+    }
+
+    // Headers are "first name", "last name", then one per Sunday column
+    for (std::size_t i = 2; i < result->headers.size(); ++i)
+    {
+        int64_t day{ 0 };
+        ParseHeaderDate(result->headers[i], day);
+        days.push_back(day);
+    }
+    streaks = StreakIndex(roll, days);
+}
+
+const std::vector<uint32_t>& RollIndex::ByName(const std::string& name) const
+{
+    static const std::vector<uint32_t> none;
+
+    auto found = names.find(ToLower(name));
+    return found == names.end() ? none : found->second;
+}
+
+// The Sunday columns (indexes into attendance_list) that fall in a month, empty when none do
+void RollIndex::MonthColumns(int year, unsigned month, uint32_t& first, uint32_t& last) const
+{
+    const int64_t begin{ DaysFromCivil(year, month, 1) };
+    const int64_t end{ begin + DaysInMonth(year, month) };
+
+    // Exports list the Sundays in date order, so the month is one run of columns
+    first = last = 0;
+    for (uint32_t i = 0; i < days.size(); ++i)
+    {
+        if (days[i] < begin || days[i] >= end)
+            continue;
+        if (first == last)
+            first = i;
+        last = i + 1;
+    }
+}
+
+RollIndex::Bucket RollIndex::BucketFor(int32_t weeksAbsent)
+{
+    if (weeksAbsent >= 99)
+        return OFF_ROLL;
+    if (weeksAbsent >= 6)
+        return WEEKS_6_PLUS;
+    return static_cast<Bucket>(weeksAbsent < 0 ? 0 : weeksAbsent);
+}
+
+std::string RollIndex::NameKey(const std::string& firstName, const std::string& lastName)
+{
+    return ToLower(firstName + " " + lastName);
+}
@@ -0,0 +1,26 @@
+// shutdown.cpp : Turn SIGINT and SIGTERM into a flag the long-running modes check
+//
+
+#include "shutdown.h"
+#include <csignal>
+
+namespace
+{
+    volatile std::sig_atomic_t stopRequested{ 0 };
+
+    void RequestStop(int)
+    {
+        stopRequested = 1;
+    }
+}
+
+void InstallStopHandlers()
+{
+    std::signal(SIGINT, RequestStop);
+    std::signal(SIGTERM, RequestStop);
+}
+
+bool StopRequested()
+{
+    return stopRequested != 0;
+}
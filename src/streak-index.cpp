@@ -0,0 +1,144 @@
+// streak-index.cpp : Run-length weeks absent history per member, for streaks as of any Sunday
+//
+
+#include "streak-index.h"
+#include <algorithm>
+
+namespace
+{
+    // Weeks absent before the first column, and for anyone off the roll
+    constexpr int32_t notOnRoll{ 99 };
+}
+
+// The roll must have been through CountAbsentWeeks, sundays holds the day number (dates.h) of each column in date order
+StreakIndex::StreakIndex(const std::vector<person>& classRoll, const std::vector<int64_t>& sundays) : days(sundays)
+{
+    offsets.reserve(classRoll.size() + 1);
+    for (const auto& member : classRoll)
+    {
+        // A run's slope is only known at its second column, -1 until then
+        int32_t runStart{ -1 };
+        int32_t runValue{ 0 };
+        int32_t slope{ -1 };
+        const auto flush = [&]
+            {
+                if (runStart < 0)
+                    return;
+                starts.push_back(runStart);
+                values.push_back(runValue);
+                counting.push_back(slope == 1 ? 1 : 0);
+            };
+
+        const int32_t columns{ static_cast<int32_t>(std::min(member.attendance_list.size(), days.size())) };
+        for (int32_t column = 0; column < columns; ++column)
+        {
+            const int32_t weeks{ static_cast<int32_t>(member.attendance_list[column].weeks_absent) };
+            if (runStart >= 0)
+            {
+                if (slope < 0 && (weeks == runValue || weeks == runValue + 1))
+                {
+                    slope = weeks - runValue;
+                    continue;
+                }
+                if (slope >= 0 && weeks == runValue + slope * (column - runStart))
+                    continue;
+            }
+
+            flush();
+            runStart = column;
+            runValue = weeks;
+            slope = -1;
+        }
+        flush();
+        offsets.push_back(static_cast<uint32_t>(starts.size()));
+    }
+}
+
+// The last Sunday column on or before day, -1 when day is before the first one
+int32_t StreakIndex::ColumnAt(int64_t day) const
+{
+    return static_cast<int32_t>(std::upper_bound(days.begin(), days.end(), day) - days.begin()) - 1;
+}
+
+// Weeks absent for one member as of a column, a binary search over their runs
+int32_t StreakIndex::WeeksAbsent(uint32_t member, int32_t column) const
+{
+    column = std::min(column, static_cast<int32_t>(days.size()) - 1);
+    const auto first = starts.begin() + offsets[member];
+    const auto last = starts.begin() + offsets[member + 1];
+    const auto run = std::upper_bound(first, last, column);
+    if (column < 0 || run == first)
+        return notOnRoll;
+    return ValueAt(static_cast<uint32_t>(run - starts.begin() - 1), column);
+}
+
+// Weeks absent for every member as of a column, one pass over the run arrays
+//  Members have a handful of runs each, counting the ones that start by the column beats a binary search per member
+//  and the count is a branch-free loop the compiler vectorises
+void StreakIndex::WeeksAbsentAll(int32_t column, std::vector<int32_t>& weeksAbsent) const
+{
+    column = std::min(column, static_cast<int32_t>(days.size()) - 1);
+    const uint32_t members{ MemberCount() };
+    weeksAbsent.assign(members, notOnRoll);
+    if (column < 0)
+        return;
+
+    const int32_t* runStarts{ starts.data() };
+    for (uint32_t member = 0; member < members; ++member)
+    {
+        const uint32_t begin{ offsets[member] };
+        const uint32_t end{ offsets[member + 1] };
+
+        uint32_t started{ 0 };
+        for (uint32_t run = begin; run < end; ++run)
+            started += runStarts[run] <= column;
+
+        if (started)
+            weeksAbsent[member] = ValueAt(begin + started - 1, column);
+    }
+}
+
+// Whether a member's absence streak reached weeks in one of the columns (fromColumn, toColumn]
+//  That is a column at weeks or more where the one before was below it, landing on 99 (off the roll) doesn't count
+bool StreakIndex::Crossed(uint32_t member, int32_t weeks, int32_t fromColumn, int32_t toColumn) const
+{
+    toColumn = std::min(toColumn, static_cast<int32_t>(days.size()) - 1);
+    fromColumn = std::max(fromColumn, 0);
+    if (weeks <= 0 || weeks >= notOnRoll || fromColumn >= toColumn)
+        return false;
+
+    // Skip to the run holding the column after fromColumn, then walk the few runs up to toColumn
+    const uint32_t begin{ offsets[member] };
+    const uint32_t end{ offsets[member + 1] };
+    const auto found = std::upper_bound(starts.begin() + begin, starts.begin() + end, fromColumn + 1);
+    uint32_t run{ static_cast<uint32_t>(std::max<std::ptrdiff_t>(found - starts.begin() - 1, begin)) };
+    for (; run < end && starts[run] <= toColumn; ++run)
+    {
+        const int32_t runEnd{ run + 1 < end ? starts[run + 1] : static_cast<int32_t>(days.size()) };
+
+        // Going in to the run, from the end of the one before
+        if (run > begin && starts[run] > fromColumn && values[run] >= weeks && values[run] < notOnRoll &&
+            ValueAt(run - 1, starts[run] - 1) < weeks)
+            return true;
+
+        // Counting up inside the run
+        if (counting[run] && values[run] < weeks)
+        {
+            const int32_t column{ starts[run] + (weeks - values[run]) };
+            if (column < runEnd && column > fromColumn && column <= toColumn)
+                return true;
+        }
+    }
+    return false;
+}
+
+// Every member whose streak crossed
+void StreakIndex::CrossedAll(int32_t weeks, int32_t fromColumn, int32_t toColumn, std::vector<uint32_t>& members) const
+{
+    members.clear();
+    for (uint32_t member = 0; member < MemberCount(); ++member)
+    {
+        if (Crossed(member, weeks, fromColumn, toColumn))
+            members.push_back(member);
+    }
+}
@@ -0,0 +1,286 @@
+// task-scheduler.cpp : The work-stealing scheduler every pipeline stage splits its work across
+//
+
+#include "task-scheduler.h"
+#include <iterator>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+    // Options for the shared scheduler, fixed once it starts
+    std::mutex sharedLock;
+    SchedulerOptions sharedOptions{};
+    bool sharedStarted{ false };
+
+    // Which scheduler's worker this thread is, if any, so a task submitting more work pushes onto its own deque
+    thread_local const TaskScheduler* currentScheduler{ nullptr };
+    thread_local unsigned currentWorker{ 0 };
+
+    // Pin the calling thread to the index-th CPU it's allowed on, wrapping around when there are more workers than CPUs
+    void PinToCpu(unsigned index)
+    {
+#ifdef _WIN32
+        DWORD_PTR processMask, systemMask;
+        if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask) || processMask == 0)
+            return;
+        std::vector<unsigned> allowed;
+        for (unsigned cpu = 0; cpu < sizeof(DWORD_PTR) * 8; ++cpu)
+        {
+            if (processMask & (DWORD_PTR{ 1 } << cpu))
+                allowed.push_back(cpu);
+        }
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{ 1 } << allowed[index % allowed.size()]);
+#elif defined(__linux__)
+        cpu_set_t set;
+        if (sched_getaffinity(0, sizeof(set), &set) != 0)
+            return;
+        std::vector<int> allowed;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+                allowed.push_back(cpu);
+        }
+        if (allowed.empty())
+            return;
+        CPU_ZERO(&set);
+        CPU_SET(allowed[index % allowed.size()], &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)index;
+#endif
+    }
+}
+
+bool TaskScheduler::Configure(const SchedulerOptions& options)
+{
+    std::lock_guard<std::mutex> guard(sharedLock);
+    if (sharedStarted)
+        return false;
+    sharedOptions = options;
+    return true;
+}
+
+TaskScheduler& TaskScheduler::Shared()
+{
+    static TaskScheduler shared{ []
+        {
+            std::lock_guard<std::mutex> guard(sharedLock);
+            sharedStarted = true;
+            return sharedOptions;
+        }() };
+    return shared;
+}
+
+TaskScheduler::TaskScheduler(const SchedulerOptions& options)
+{
+    unsigned threadCount{ options.workers };
+    if (threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0)
+        threadCount = 1;
+
+    // Every deque exists before any worker starts looking in them
+    workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i)
+        workers.push_back(std::make_unique<Worker>());
+    for (unsigned i = 0; i < threadCount; ++i)
+        workers[i]->thread = std::thread(&TaskScheduler::Run, this, i, options.pin_threads);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers)
+        worker->thread.join();
+}
+
+// A worker's own tasks go on the back of its deque, anyone else's on the shared queue
+void TaskScheduler::Submit(Task task)
+{
+    if (currentScheduler == this)
+    {
+        Worker& worker{ *workers[currentWorker] };
+        std::lock_guard<std::mutex> guard(worker.lock);
+        worker.tasks.push_back(std::move(task));
+    }
+    else
+    {
+        std::lock_guard<std::mutex> guard(injectedLock);
+        injected.push_back(std::move(task));
+    }
+    queued.fetch_add(1);
+
+    // Taking the lock orders this with a sleeper checking queued, so the wake can't be missed
+    //  Everyone is woken, a thread waiting on another group would take the wake and go back to sleep
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+    }
+    wake.notify_all();
+}
+
+// Newest of our own first, then the shared queue, then the oldest of someone else's
+bool TaskScheduler::Take(Task& task, const TaskGroup* group)
+{
+    if (queued.load() == 0 || (group && group->unstarted.load() == 0))
+        return false;
+
+    bool taken{ false };
+    const bool isWorker{ currentScheduler == this };
+    if (isWorker)
+    {
+        Worker& own{ *workers[currentWorker] };
+        std::lock_guard<std::mutex> guard(own.lock);
+        taken = TakeFrom(own.tasks, true, group, task);
+    }
+
+    if (!taken)
+    {
+        std::lock_guard<std::mutex> guard(injectedLock);
+        taken = TakeFrom(injected, false, group, task);
+    }
+
+    const std::size_t count{ workers.size() };
+    const std::size_t first{ isWorker ? currentWorker + 1 : 0 };
+    for (std::size_t i = 0; i < count && !taken; ++i)
+    {
+        Worker& victim{ *workers[(first + i) % count] };
+        std::lock_guard<std::mutex> guard(victim.lock);
+        taken = TakeFrom(victim.tasks, false, group, task);
+    }
+
+    if (taken)
+    {
+        queued.fetch_sub(1);
+        task.group->unstarted.fetch_sub(1);
+    }
+    return taken;
+}
+
+// The newest or oldest task in a deque, of group when one is given, the caller holds the deque's lock
+bool TaskScheduler::TakeFrom(std::deque<Task>& tasks, bool newest, const TaskGroup* group, Task& task)
+{
+    const auto matches = [group](const Task& each) { return !group || each.group == group; };
+    if (newest)
+    {
+        const auto found = std::find_if(tasks.rbegin(), tasks.rend(), matches);
+        if (found == tasks.rend())
+            return false;
+        task = std::move(*found);
+        tasks.erase(std::next(found).base());
+    }
+    else
+    {
+        const auto found = std::find_if(tasks.begin(), tasks.end(), matches);
+        if (found == tasks.end())
+            return false;
+        task = std::move(*found);
+        tasks.erase(found);
+    }
+    return true;
+}
+
+bool TaskScheduler::TryRunOne(const TaskGroup* group)
+{
+    Task task;
+    if (!Take(task, group))
+        return false;
+
+    std::exception_ptr error;
+    try
+    {
+        task.run();
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    task.group->Finished(error);
+    return true;
+}
+
+void TaskScheduler::Run(unsigned index, bool pin)
+{
+    currentScheduler = this;
+    currentWorker = index;
+    if (pin)
+        PinToCpu(index);
+
+    for (;;)
+    {
+        if (TryRunOne())
+            continue;
+
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wake.wait(guard, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0)
+            return; // stopping, and nothing left to do
+    }
+}
+
+TaskGroup::~TaskGroup()
+{
+    try
+    {
+        Wait();
+    }
+    catch (...)
+    {
+    }
+}
+
+void TaskGroup::Run(std::function<void()> task)
+{
+    pending.fetch_add(1);
+    unstarted.fetch_add(1);
+    scheduler.Submit({ std::move(task), this });
+}
+
+void TaskGroup::Wait()
+{
+    while (pending.load() > 0)
+    {
+        if (scheduler.TryRunOne(this))
+            continue;
+
+        // None of ours to take, so the rest of the group is running on other threads, sleep until it's done or more of it turns up
+        std::unique_lock<std::mutex> guard(scheduler.sleepLock);
+        scheduler.wake.wait(guard, [this] { return pending.load() == 0 || unstarted.load() > 0; });
+    }
+
+    std::lock_guard<std::mutex> guard(errorLock);
+    if (error)
+        std::rethrow_exception(std::exchange(error, nullptr));
+}
+
+// The last task of the group to finish wakes whoever is waiting on it
+void TaskGroup::Finished(std::exception_ptr taskError)
+{
+    if (taskError)
+    {
+        std::lock_guard<std::mutex> guard(errorLock);
+        if (!error)
+            error = taskError;
+    }
+
+    // Once pending reaches 0 the waiter may return and destroy the group, so nothing of it is touched after
+    TaskScheduler& owner{ scheduler };
+    if (pending.fetch_sub(1) == 1)
+    {
+        std::lock_guard<std::mutex> guard(owner.sleepLock);
+        owner.wake.notify_all();
+    }
+}
@@ -0,0 +1,292 @@
+// uring-byte-source.cpp : An io_uring byte source with several block reads in flight, Linux only
+//
+
+#include "uring-byte-source.h"
+
+#ifdef __linux__
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace
+{
+    // 8 reads of 512KB in flight, 4MB of buffers however large the export is
+    constexpr unsigned queueDepth{ 8 };
+    constexpr std::size_t chunkLength{ 512 * 1024 };
+
+    // Page aligned, which O_DIRECT would need too
+    constexpr std::size_t bufferAlignment{ 4096 };
+
+    class UringByteSource : public io::ByteSourceBase
+    {
+    public:
+        explicit UringByteSource(int fd) : fileFd(fd) {}
+        ~UringByteSource() override;
+
+        // Set up the ring and queue the first reads, false when io_uring isn't there
+        bool Open();
+
+        int read(char* buffer, int size) override;
+
+    private:
+        // One buffer of the ring, holding the file from offset on
+        struct Chunk
+        {
+            iovec target{};           // where the read in flight lands
+            uint64_t offset{ 0 };
+            std::size_t filled{ 0 };  // bytes read so far
+            std::size_t taken{ 0 };   // bytes handed to the line reader
+            int error{ 0 };
+            bool inFlight{ false };
+            bool atEnd{ false };      // a read came back empty, the file ends at offset + filled
+        };
+
+        void Queue(unsigned index);
+        bool Submit(bool wait);
+        void Reap();
+
+        int fileFd;
+        int ringFd{ -1 };
+        void* sqRing{ nullptr };
+        void* cqRing{ nullptr };
+        std::size_t sqRingLength{ 0 };
+        std::size_t cqRingLength{ 0 };
+        io_uring_sqe* sqes{ nullptr };
+        std::size_t sqesLength{ 0 };
+        unsigned* sqTail{ nullptr };
+        unsigned* sqMask{ nullptr };
+        unsigned* sqArray{ nullptr };
+        unsigned* cqHead{ nullptr };
+        unsigned* cqTail{ nullptr };
+        unsigned* cqMask{ nullptr };
+        io_uring_cqe* cqes{ nullptr };
+
+        char* buffers{ nullptr };
+        Chunk chunks[queueDepth];
+        unsigned head{ 0 };        // the chunk the line reader is reading from
+        unsigned queued{ 0 };      // reads written to the submission ring but not yet submitted
+        unsigned submitted{ 0 };   // reads the kernel has and hasn't completed
+        bool finished{ false };
+    };
+
+    UringByteSource::~UringByteSource()
+    {
+        // The kernel writes into the buffers until each read completes, wait them out before freeing anything
+        //  If waiting fails the buffers are leaked rather than handed back while a read may still land in them
+        while (submitted > 0 && Submit(true));
+        if (submitted == 0)
+            std::free(buffers);
+
+        if (sqes)
+            munmap(sqes, sqesLength);
+        if (cqRing && cqRing != sqRing)
+            munmap(cqRing, cqRingLength);
+        if (sqRing)
+            munmap(sqRing, sqRingLength);
+        if (ringFd >= 0)
+            close(ringFd);
+        close(fileFd);
+    }
+
+    bool UringByteSource::Open()
+    {
+        io_uring_params params{};
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, queueDepth, &params));
+        if (ringFd < 0)
+            return false;
+
+        // Kernels before 5.4 map the submission and completion rings separately
+        sqRingLength = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingLength = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMap{ (params.features & IORING_FEAT_SINGLE_MMAP) != 0 };
+        if (singleMap)
+            sqRingLength = cqRingLength = std::max(sqRingLength, cqRingLength);
+
+        void* mapped = mmap(nullptr, sqRingLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        if (mapped == MAP_FAILED)
+            return false;
+        sqRing = mapped;
+
+        mapped = singleMap ? sqRing : mmap(nullptr, cqRingLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (mapped == MAP_FAILED)
+            return false;
+        cqRing = mapped;
+
+        sqesLength = params.sq_entries * sizeof(io_uring_sqe);
+        mapped = mmap(nullptr, sqesLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+        if (mapped == MAP_FAILED)
+            return false;
+        sqes = static_cast<io_uring_sqe*>(mapped);
+
+        char* sq{ static_cast<char*>(sqRing) };
+        char* cq{ static_cast<char*>(cqRing) };
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        buffers = static_cast<char*>(std::aligned_alloc(bufferAlignment, queueDepth * chunkLength));
+        if (buffers == nullptr)
+            return false;
+
+        // The first queueDepth chunks of the file, all at once
+        for (unsigned index = 0; index < queueDepth; ++index)
+        {
+            chunks[index].offset = index * chunkLength;
+            Queue(index);
+        }
+        return Submit(false);
+    }
+
+    // Fill the line reader's block, waiting only when the chunk it needs next hasn't arrived yet
+    //  A short return is the end of the input, so keep going until size bytes or the end of the file
+    int UringByteSource::read(char* buffer, int size)
+    {
+        int total{ 0 };
+        while (total < size && !finished)
+        {
+            Chunk& chunk{ chunks[head] };
+            while (chunk.inFlight)
+            {
+                if (!Submit(true))
+                    throw std::system_error(errno, std::generic_category(), "Failed reading input");
+            }
+            if (chunk.error != 0)
+                throw std::system_error(chunk.error, std::generic_category(), "Failed reading input");
+
+            const std::size_t count{ std::min(chunk.filled - chunk.taken, static_cast<std::size_t>(size - total)) };
+            std::memcpy(buffer + total, buffers + head * chunkLength + chunk.taken, count);
+            chunk.taken += count;
+            total += static_cast<int>(count);
+            if (chunk.taken < chunk.filled)
+                break;
+
+            if (chunk.atEnd)
+            {
+                finished = true;
+                break;
+            }
+
+            // Used up, read the chunk after the last one queued into it
+            chunk.offset += queueDepth * chunkLength;
+            chunk.filled = chunk.taken = 0;
+            Queue(head);
+            head = (head + 1) % queueDepth;
+        }
+
+        if (queued > 0 && !Submit(false))
+            throw std::system_error(errno, std::generic_category(), "Failed reading input");
+        return total;
+    }
+
+    // Write a read of the rest of a chunk to the submission ring, Submit hands it to the kernel
+    void UringByteSource::Queue(unsigned index)
+    {
+        Chunk& chunk{ chunks[index] };
+        chunk.target = { buffers + index * chunkLength + chunk.filled, chunkLength - chunk.filled };
+        chunk.inFlight = true;
+
+        // Only this source moves the tail, the kernel reads it
+        const unsigned tail{ *sqTail };
+        const unsigned slot{ tail & *sqMask };
+        io_uring_sqe& sqe{ sqes[slot] };
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READV; // IORING_OP_READ needs 5.6, READV works on every kernel with io_uring
+        sqe.fd = fileFd;
+        sqe.addr = reinterpret_cast<uint64_t>(&chunk.target);
+        sqe.len = 1;
+        sqe.off = chunk.offset + chunk.filled;
+        sqe.user_data = index;
+        sqArray[slot] = slot;
+        std::atomic_ref<unsigned>(*sqTail).store(tail + 1, std::memory_order_release);
+        ++queued;
+    }
+
+    // Hand the queued reads to the kernel, waiting for at least one completion if asked, then collect what completed
+    bool UringByteSource::Submit(bool wait)
+    {
+        for (;;)
+        {
+            const long count = syscall(__NR_io_uring_enter, ringFd, queued, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (count >= 0)
+            {
+                queued -= static_cast<unsigned>(count);
+                submitted += static_cast<unsigned>(count);
+                break;
+            }
+            if (errno != EINTR)
+                return false;
+        }
+        Reap();
+        return true;
+    }
+
+    // Take every completion off the ring, a short read queues the rest of its chunk again
+    void UringByteSource::Reap()
+    {
+        unsigned cqIndex{ *cqHead };
+        const unsigned tail{ std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire) };
+        for (; cqIndex != tail; ++cqIndex)
+        {
+            const io_uring_cqe& cqe{ cqes[cqIndex & *cqMask] };
+            Chunk& chunk{ chunks[cqe.user_data] };
+            chunk.inFlight = false;
+            --submitted;
+
+            if (cqe.res > 0)
+            {
+                chunk.filled += static_cast<std::size_t>(cqe.res);
+                if (chunk.filled < chunkLength)
+                    Queue(static_cast<unsigned>(cqe.user_data));
+            }
+            else if (cqe.res == 0)
+            {
+                chunk.atEnd = true;
+            }
+            else if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+            {
+                Queue(static_cast<unsigned>(cqe.user_data));
+            }
+            else
+            {
+                chunk.error = -cqe.res;
+            }
+        }
+        std::atomic_ref<unsigned>(*cqHead).store(cqIndex, std::memory_order_release);
+    }
+}
+#endif
+
+std::unique_ptr<io::ByteSourceBase> OpenUringByteSource(const std::string& filePath)
+{
+#ifdef __linux__
+    // Compressed exports go through LineReader's decompressing sources
+    if (filePath.ends_with(".gz") || filePath.ends_with(".zst"))
+        return nullptr;
+
+    const int fd{ open(filePath.c_str(), O_RDONLY | O_CLOEXEC) };
+    if (fd < 0)
+        return nullptr;
+
+    auto source = std::make_unique<UringByteSource>(fd);
+    if (!source->Open())
+        return nullptr;
+    return source;
+#else
+    (void)filePath;
+    return nullptr;
+#endif
+}
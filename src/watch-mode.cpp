@@ -0,0 +1,233 @@
+// watch-mode.cpp : --watch, process exports as they land in a drop directory until told to stop
+//
+
+#include "watch-mode.h"
+#include "directory-watcher.h"
+#include "eya-attendance.h"
+#include "query-server.h"
+#include "shutdown.h"
+#include "task-scheduler.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+
+namespace
+{
+    // Workers finish in any order, keep their lines from interleaving
+    std::mutex consoleLock;
+
+    void Log(const std::string& message)
+    {
+        std::lock_guard<std::mutex> guard(consoleLock);
+        std::cout << message << std::endl;
+    }
+
+    // Write next to the real file and rename over it, so whoever picks the reports up never sees half of one
+    bool WriteAtomically(const std::filesystem::path& path, const std::function<bool(std::ostream&)>& write)
+    {
+        std::filesystem::path temporary{ path };
+        temporary += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+        bool written;
+        {
+            std::ofstream outFile(temporary);
+            written = write(outFile);
+            outFile.close();
+            written = written && !outFile.fail();
+        }
+
+        std::error_code ec;
+        if (written)
+            std::filesystem::rename(temporary, path, ec);
+        if (!written || ec)
+        {
+            std::filesystem::remove(temporary, ec);
+            return false;
+        }
+        return true;
+    }
+
+    // Hands the server the newest roll processed so far, exports finish in any order and an old one finishing late mustn't replace it
+    //  Newer is a later date in the export's name, or the same date and started later, one without a date never replaces one with
+    class LatestRoll
+    {
+    public:
+        explicit LatestRoll(QueryServer* server) : server(server) {}
+
+        // Call as an export starts, the order exports of the same date are published in
+        uint64_t Start() { return started.fetch_add(1) + 1; }
+
+        bool Serving() const { return server != nullptr; }
+
+        void Publish(uint64_t sequence, std::shared_ptr<const eya::AnalysisResult> analysis)
+        {
+            if (!server)
+                return;
+
+            std::lock_guard<std::mutex> guard(lock);
+            if (analysis->date < date || (analysis->date == date && sequence < publishedSequence))
+                return;
+            date = analysis->date;
+            publishedSequence = sequence;
+            server->Publish(std::make_shared<RollIndex>(std::move(analysis)));
+        }
+
+    private:
+        QueryServer* server;
+        std::atomic<uint64_t> started{ 0 };
+        std::mutex lock;
+        std::string date{};
+        uint64_t publishedSequence{ 0 };
+    };
+
+    // One export, start to finish, on a worker thread
+    void ProcessExport(const std::string& filePath, const std::filesystem::path& outputDirectory, eya::AnalysisCache& cache, const WatchOptions& options, LatestRoll& latest)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t sequence{ latest.Start() };
+
+        auto analysis = std::make_shared<eya::AnalysisResult>();
+        eya::AnalysisResult& result{ *analysis };
+        eya::Diagnostics diagnostics;
+
+        // Long exports are held compressed, unless the roll is going to be served to queries
+        eya::Pipeline pipeline{ options.outreach_only ? eya::Pipeline::OUTREACH_ONLY : eya::Pipeline::FULL };
+        if (pipeline == eya::Pipeline::FULL && !latest.Serving())
+            pipeline = eya::PipelineForExport(filePath);
+        const eya::Status status{ eya::AnalyzeFile(filePath, result, diagnostics, &cache, options.outreach_rules, pipeline) };
+
+        std::ostringstream message;
+        message << std::filesystem::path(filePath).filename().string() << ": ";
+        if (status != eya::Status::OK)
+        {
+            message << "failed, " << eya::ToString(status);
+        }
+        else if (!WriteAtomically(outputDirectory / eya::OutreachFileName(result), [&](std::ostream& out) { return eya::WriteOutreach(out, result); }) ||
+            !WriteAtomically(outputDirectory / eya::OutreachStateFileName(result), [&](std::ostream& out) { return eya::WriteOutreachState(out, result); }) ||
+            (!options.outreach_only &&
+                (!WriteAtomically(outputDirectory / eya::ReportFileName(result), [&](std::ostream& out) { return eya::WriteReport(out, result); }) ||
+                !WriteAtomically(outputDirectory / eya::AnalyticsFileName(result), [&](std::ostream& out) { return eya::WriteAnalytics(out, result); }) ||
+                !WriteAtomically(outputDirectory / eya::CohortFileName(result), [&](std::ostream& out) { return eya::WriteCohorts(out, result); }) ||
+                (options.top_k != 0 && !WriteAtomically(outputDirectory / eya::AtRiskFileName(result), [&](std::ostream& out)
+                    {
+                        eya::AtRiskRanking ranking;
+                        return eya::RankAtRisk(result, options.top_k, ranking) && eya::WriteAtRisk(out, result, ranking);
+                    })))))
+        {
+            message << "failed writing the reports to " << outputDirectory.string();
+        }
+        else
+        {
+            const std::chrono::duration<double, std::milli> elapsed{ std::chrono::steady_clock::now() - start };
+            message << result.roll.size() << " members, " << result.outreach.size() << " to reach out to, " << static_cast<uint64_t>(elapsed.count()) << " ms";
+
+            latest.Publish(sequence, std::move(analysis));
+        }
+
+        for (const auto& diagnostic : diagnostics)
+        {
+            message << "\n    " << diagnostic.message;
+        }
+        Log(message.str());
+    }
+}
+
+// Runs until SIGINT or SIGTERM, then finishes the exports already queued, returns the exit code
+//  With a server, it answers questions about the newest export processed so far (see LatestRoll)
+int RunWatchMode(const WatchOptions& options, QueryServer* server)
+{
+    const std::filesystem::path outputDirectory{ options.output_directory.empty()
+        ? std::filesystem::path(options.directory) / "reports"
+        : std::filesystem::path(options.output_directory) };
+
+    DirectoryWatcher watcher{ options.directory, std::chrono::milliseconds(options.settle_ms) };
+    std::string reason;
+    if (!watcher.Open(reason))
+    {
+        std::cout << reason << std::endl;
+        return -2;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(outputDirectory, ec);
+    if (ec)
+    {
+        std::cout << "Failed creating the output directory " << outputDirectory.string() << ": " << ec.message() << std::endl;
+        return -7;
+    }
+
+    InstallStopHandlers();
+
+    // Shared by every worker, so each export after the first only pays for its own parse
+    eya::AnalysisCache cache;
+    LatestRoll latest{ server };
+
+    // A file that changes again while it is being processed is run once more afterwards, never twice at the same time
+    std::mutex flightLock;
+    std::unordered_set<std::string> inFlight;
+    std::unordered_set<std::string> rerun;
+
+    // Last, so it is waited for before anything its jobs use goes away
+    //  Exports run as tasks on the shared scheduler, the stages inside each one split their work across the same workers
+    TaskGroup jobs;
+
+    auto submit = [&](const std::string& filePath)
+        {
+            {
+                std::lock_guard<std::mutex> guard(flightLock);
+                if (!inFlight.insert(filePath).second)
+                {
+                    rerun.insert(filePath);
+                    return;
+                }
+            }
+
+            jobs.Run([&, filePath]
+                {
+                    for (;;)
+                    {
+                        try
+                        {
+                            ProcessExport(filePath, outputDirectory, cache, options, latest);
+                        }
+                        catch (std::exception& err)
+                        {
+                            Log(filePath + ": failed, " + err.what());
+                        }
+
+                        std::lock_guard<std::mutex> guard(flightLock);
+                        if (rerun.erase(filePath) == 0)
+                        {
+                            inFlight.erase(filePath);
+                            return;
+                        }
+                    }
+                });
+        };
+
+    Log("Watching " + options.directory + (watcher.UsingInotify() ? " (inotify)" : " (polling)") + ", reports go to " + outputDirectory.string() +
+        ", " + std::to_string(jobs.Size()) + " worker(s)\nCtrl+C or SIGTERM stops once the queued exports are done");
+
+    std::vector<std::string> ready;
+    while (!StopRequested())
+    {
+        ready.clear();
+        watcher.Poll(std::chrono::milliseconds(250), ready);
+        for (const auto& filePath : ready)
+            submit(filePath);
+    }
+
+    Log("Stopping, finishing the exports already queued");
+    jobs.Wait();
+    Log("Stopped");
+
+    return 0;
+}